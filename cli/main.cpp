@@ -58,8 +58,10 @@ void HelpDialog(const argh::parser &cmdl)
 
     cout << "Usage: " << CliName << " [INPUT] [OPTIONS]\n" << endl;
     cout << "-h, --help\tThis dialog" << endl;
-    cout << "-m, --mesher\tSets the mesher to meshify the voxel mesh. Default: simple. (simple, greedy, greedy_chunked, greedy_textured, marching_cubes)" << endl;
+    cout << "-m, --mesher\tSets the mesher to meshify the voxel mesh. Default: simple. (simple, greedy, greedy_chunked, greedy_textured, greedy_mask, marching_cubes, surface_nets)" << endl;
     cout << "-o, --output\tOutput path. If the output path doesn't exist it will be created" << endl;
+    cout << "-s, --smooth\tShares the vertices of the marching cubes mesher and smooths the normals" << endl;
+    cout << "--smooth_iterations\tCount of laplacian smoothing passes over the vertices, if --smooth is set. Default: 0" << endl;
     cout << "-w, --worldspace\tTransforms all vertices to worldspace\n" << endl;
     cout << "Examples:" << endl;
     cout << CliName << " windmill.vox -o windmill.glb\tConverts the *.vox file to a *.glb" << endl;
@@ -219,7 +221,7 @@ vector<File> ResolveFilenames(const argh::parser &cmdl, const string &OutputPatt
 int main(int argc, char const *argv[])
 {
     auto cmdl = argh::parser();
-    cmdl.add_params({"-o", "--output", "-m", "--mesher"});
+    cmdl.add_params({"-o", "--output", "-m", "--mesher", "--smooth_iterations"});
     cmdl.parse(argc, argv);
 
     // Shows the help dialog.
@@ -257,9 +259,20 @@ int main(int argc, char const *argv[])
             Mesher = VCore::IMesher::Create(VCore::MesherTypes::GREEDY_CHUNKED);
         else if(MesherType == "greedy_textured")
             Mesher = VCore::IMesher::Create(VCore::MesherTypes::GREEDY_TEXTURED);
+        else if(MesherType == "greedy_mask")
+            Mesher = VCore::IMesher::Create(VCore::MesherTypes::GREEDY_MASK);
+        else if(MesherType == "surface_nets")
+            Mesher = VCore::IMesher::Create(VCore::MesherTypes::SURFACE_NETS);
         else
             Mesher = VCore::IMesher::Create(VCore::MesherTypes::SIMPLE);
 
+        if(cmdl[{"-s", "--smooth"}])
+        {
+            int SmoothingIterations;
+            cmdl("--smooth_iterations", 0) >> SmoothingIterations;
+            Mesher->SetSmoothShading(true, SmoothingIterations);
+        }
+
         auto Files = ResolveFilenames(cmdl, OutputPattern);
         for (auto &&f : Files)
         {
@@ -76,6 +76,7 @@ class CGodotVoxelEditor : public Reference
         void RegenerateMesh();
 
         Ref<CMeshCache> m_MeshCache;
+        VCore::Mesher m_Mesher;     //!< Keeps the chunk meshes between edits, so only the changed chunks are remeshed.
 };
 
 #endif
\ No newline at end of file
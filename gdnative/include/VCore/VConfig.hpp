@@ -27,6 +27,41 @@
 
 #include <PoolArrays.hpp>
 
+// The following macros define the memory layout of a single voxel.
+
+/**
+ * @brief Stores the color and material index of a voxel in one byte each. A voxel shrinks from 8 to 4 bytes,
+ * but a model may use at most 255 colors and 255 materials.
+ * CVoxelModel::SetVoxel throws for larger indices and the loaders report palettes which don't fit.
+ */
+// #define VOXEL_COMPACT
+
+/**
+ * @brief Integer types of the color and material index of a voxel.
+ * @note The value -1 converted to the type marks an empty voxel, so it can't be used as an index.
+ */
+#ifndef VOXEL_COLOR_TYPE
+#ifdef VOXEL_COMPACT
+#define VOXEL_COLOR_TYPE uint8_t
+#else
+#define VOXEL_COLOR_TYPE int
+#endif
+#endif
+
+#ifndef VOXEL_MATERIAL_TYPE
+#ifdef VOXEL_COMPACT
+#define VOXEL_MATERIAL_TYPE uint8_t
+#else
+#define VOXEL_MATERIAL_TYPE short
+#endif
+#endif
+
+/**
+ * @brief Adds the member AO to SVertex, which receives the baked ambient occlusion of IMesher::SetAmbientOcclusion.
+ * 1 means no occlusion, 0 a fully occluded vertex.
+ */
+// #define VERTEX_AMBIENT_OCCLUSION
+
 // The following macros allow you to use your engine or framework's mesh data structures instead of the V-Core's.
 
 /**
@@ -72,6 +107,18 @@
     }
 #endif
 
+/**
+ * @brief Defines how to reserve memory for a number of vertices, before they are added.
+ * The pool arrays of godot can't reserve memory without changing their size.
+ */
+#ifndef RESERVE_VERTEX_DATA_METHOD
+#define RESERVE_VERTEX_DATA_METHOD          \
+    void Reserve(size_t _Size)              \
+    {                                       \
+        (void)_Size;                        \
+    }
+#endif
+
 /**
  * @brief Defines how to access a vertex by its index.
  */
@@ -84,9 +84,10 @@ void CGodotVoxelEditor::RemoveVoxel(Vector3 _Pos)
 
 void CGodotVoxelEditor::RegenerateMesh()
 {
-    VCore::Mesher mesher = VCore::IMesher::Create(VCore::MesherTypes::GREEDY);
-    auto chunks = mesher->GenerateMeshes(m_MeshCache->GetVoxelMesh(), true);
-    
+    if(!m_Mesher)
+        m_Mesher = VCore::IMesher::Create(VCore::MesherTypes::GREEDY);
+
+    auto delta = m_Mesher->UpdateChunks(m_MeshCache->GetVoxelMesh());
 }
 
 Ref<CIntersection> CGodotVoxelEditor::Intersects(Vector3 _Pos, Vector3 _Dir) const
@@ -25,6 +25,35 @@
 #ifndef VCONFIG_HPP
 #define VCONFIG_HPP
 
+// The following macros define the memory layout of a single voxel.
+
+/**
+ * @brief Stores the color and material index of a voxel in one byte each. A voxel shrinks from 8 to 4 bytes,
+ * but a model may use at most 255 colors and 255 materials.
+ * CVoxelModel::SetVoxel throws for larger indices and the loaders report palettes which don't fit.
+ */
+// #define VOXEL_COMPACT
+
+/**
+ * @brief Integer types of the color and material index of a voxel.
+ * @note The value -1 converted to the type marks an empty voxel, so it can't be used as an index.
+ */
+#ifndef VOXEL_COLOR_TYPE
+#ifdef VOXEL_COMPACT
+#define VOXEL_COLOR_TYPE uint8_t
+#else
+#define VOXEL_COLOR_TYPE int
+#endif
+#endif
+
+#ifndef VOXEL_MATERIAL_TYPE
+#ifdef VOXEL_COMPACT
+#define VOXEL_MATERIAL_TYPE uint8_t
+#else
+#define VOXEL_MATERIAL_TYPE short
+#endif
+#endif
+
 /**
  * @brief Defines how data of a vertex should be stored.
  */
@@ -61,6 +90,17 @@
         UV.push_back(_Vertex.UV);           \
     }
 
+/**
+ * @brief Defines how to reserve memory for a number of vertices, before they are added.
+ */
+#define RESERVE_VERTEX_DATA_METHOD          \
+    void Reserve(size_t _Size)              \
+    {                                       \
+        Vertices.reserve(_Size);            \
+        Normals.reserve(_Size);             \
+        UV.reserve(_Size);                  \
+    }
+
 /**
  * @brief Defines how to access a vertex by its index.
  */
@@ -32,7 +32,7 @@ namespace VCore
     class CExportSettings
     {
         public:
-            CExportSettings() : WorldSpace(false), Binary(false) {}
+            CExportSettings() : WorldSpace(false), Binary(false), Compact(false) {}
 
             //!< Exports the models in world space instead of object space.
             bool WorldSpace;
@@ -40,6 +40,9 @@ namespace VCore
             //!< Not supported by all formats.
             bool Binary;
 
+            //!< Stores quantised vertex attributes and 16 bit indices, if the format supports it. Only glTF and FBX are affected.
+            bool Compact;
+
             ~CExportSettings() = default;
     };
 
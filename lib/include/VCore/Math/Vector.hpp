@@ -61,6 +61,16 @@ namespace VCore
                     return sqrt((x * x) + (y * y));
                 }
 
+                inline TVector2 min(const TVector2 &vec) const
+                {
+                    return TVector2(std::min(x, vec.x), std::min(y, vec.y));
+                }
+
+                inline TVector2 max(const TVector2 &vec) const
+                {
+                    return TVector2(std::max(x, vec.x), std::max(y, vec.y));
+                }
+
                 inline TVector2 operator*(const TVector2 &vr) const
                 {
                     return TVector2(x * vr.x, y * vr.y);
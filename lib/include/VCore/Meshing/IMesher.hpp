@@ -29,6 +29,8 @@
 #include <VCore/Voxel/VoxelModel.hpp>
 #include <VCore/Voxel/VoxelAnimation.hpp>
 #include <VCore/Meshing/Mesh.hpp>
+#include <VCore/Misc/ThreadPool.hpp>
+#include <mutex>
 
 namespace VCore
 {
@@ -42,17 +44,27 @@ namespace VCore
         MARCHING_CUBES,
         GREEDY_CHUNKED,   //!< Old legacy greedy mesher, which looks very chunky.
         GREEDY_TEXTURED,
+        GREEDY_MASK,      //!< Greedy mesher, which merges faces on a 2D mask per slice. Faster than GREEDY_CHUNKED and produces the same or fewer faces.
+        SURFACE_NETS,     //!< Smooth mesher with one vertex per surface cell. Faster than MARCHING_CUBES and produces fewer triangles.
     };
 
     struct SMeshChunk : public SChunkMeta
     {
         Mesh MeshData;          //!< Mesh of the voxel model.
+        int Lod = 0;            //!< Level of detail of the mesh. The mesh has been generated from a model, which is downsampled by 2^Lod.
+    };
+
+    struct SMeshChunkDelta
+    {
+        std::vector<SMeshChunk> Added;      //!< Chunks which didn't exist during the last update.
+        std::vector<SMeshChunk> Updated;    //!< Chunks which have been remeshed, replaces the mesh with the same UniqueId.
+        std::vector<size_t> Removed;        //!< UniqueIds of the chunks which no longer exist.
     };
 
     class IMesher
     {
         public:
-            IMesher() : m_Frustum(nullptr) {}
+            IMesher() : m_Frustum(nullptr), m_SmoothShading(false), m_SmoothingIterations(0), m_AmbientOcclusion(false), m_VertexDeduplication(true) {}
 
             /**
              * @brief Creates a new mesher instance.
@@ -79,15 +91,88 @@ namespace VCore
              */
             void SetFrustum(const CFrustum *_Frustum);
 
+            /**
+             * @brief Enables the level of detail for ::GenerateChunks. Chunks, which are farther away from _Viewer than _Distances[i], are meshed from a model downsampled by 2^(i + 1).
+             * Coarse chunks cover 8 chunks of the next finer level, so distant regions need fewer chunks and vertices.
+             * The downsampled models are cached per model, until its voxels change.
+             * 
+             * @param _Viewer: Position of the viewer in voxel space.
+             * @param _Distances: Ascending distance of each level. An empty list disables the level of detail.
+             */
+            void SetLod(const Math::Vec3f &_Viewer, const std::vector<float> &_Distances);
+
+            /**
+             * @brief Enables smooth shading for meshers with sloped surfaces, currently only marching cubes. Triangles share the vertices on their edges and each vertex normal is averaged over the surrounding triangles.
+             * Block based meshers ignore this setting.
+             * 
+             * @param _Enable: Enables or disables the smooth shading.
+             * @param _Iterations: Count of laplacian smoothing passes over the vertex positions. 0 keeps the positions.
+             * 
+             * @note Every pass reads one more voxel into the neighbouring chunks, so ::UpdateChunks remeshes all chunks within ::GetHaloRadius of an edit.
+             */
+            void SetSmoothShading(bool _Enable, int _Iterations = 0);
+
+            /**
+             * @brief Bakes the ambient occlusion of the neighbouring voxels into each vertex of the block based meshers (simple, greedy and greedy_mask). Faces are only merged, if their occlusion matches.
+             * 
+             * @note The occlusion is stored in SVertex::AO, which requires VERTEX_AMBIENT_OCCLUSION inside the VConfig.hpp. Without it only the quad diagonals follow the occlusion.
+             */
+            void SetAmbientOcclusion(bool _Enable);
+
+            /**
+             * @brief Enables or disables the sharing of equal vertices between the quads of the block based meshers (simple, greedy, greedy_chunked and greedy_mask). Enabled by default.
+             * Without it every quad gets its own 4 vertices, which skips the hash lookup of each vertex and the welding of the chunk meshes, but produces more vertices.
+             */
+            void SetVertexDeduplication(bool _Enable);
+
+            /**
+             * @brief Sets the thread pool, which generates the chunks. Several meshers can share the same pool.
+             */
+            void SetThreadPool(std::shared_ptr<CThreadPool> _Pool);
+
+            /**
+             * @return Returns the thread pool of this mesher. Creates a pool with one thread per core, if none has been set.
+             */
+            std::shared_ptr<CThreadPool> GetThreadPool();
+
+            /**
+             * @return Returns the count of voxels, which the mesher reads beyond the border of a chunk with the current settings. 0 if a chunk only depends on its own voxels.
+             */
+            virtual int GetHaloRadius() const { return 0; }
+
             /**
              * @brief Generates list of meshed chunks.
              * 
              * @param _Mesh: Voxel mesh to meshify.
-             * @param _OnlyDirty: Meshes only dirty chunks.
+             * @param _OnlyDirty: Meshes only dirty chunks, together with all chunks within ::GetHaloRadius of a dirty one.
+             * With the level of detail, only the selected chunks of any level are returned, which cover such a chunk.
+             * A new viewer position, distance list or frustum changes the selection itself, which needs a full call.
              * @param _ChunkCount: Count of chunks to meshify.
              */
             virtual std::vector<SMeshChunk> GenerateChunks(VoxelModel _Mesh, bool _OnlyDirty = false);
 
+            /**
+             * @brief Remeshes all dirty chunks of the model and keeps the mesh of each chunk in a cache.
+             * The first call, or a call with another model, meshes all chunks.
+             * 
+             * @note Chunks which are touched by an update of the visibility or lie within ::GetHaloRadius of a dirty chunk are remeshed as well. The frustum and the level of detail are ignored.
+             * @return Returns the chunks which have been added, remeshed or removed since the last call.
+             */
+            SMeshChunkDelta UpdateChunks(VoxelModel _Mesh);
+
+            /**
+             * @return Returns the cached mesh of each chunk of the last ::UpdateChunks call, the key is the start of the chunk.
+             */
+            inline const VectoriMap<SMeshChunk> &GetCachedChunks() const
+            {
+                return m_ChunkCache;
+            }
+
+            /**
+             * @brief Clears the cache of ::UpdateChunks and the downsampled models of the level of detail. The next update meshes all chunks again.
+             */
+            void ClearChunkCache();
+
             virtual ~IMesher();
         protected:
             /// @brief Called inside ::GenerateChunks for every chunk using multiple threads.
@@ -97,8 +182,59 @@ namespace VCore
             /// @return Returns the _Chunk + its generated mesh.
             virtual SMeshChunk GenerateMeshChunk(VoxelModel, const SChunkMeta&, bool) { return {}; }
 
-            std::vector<Mesh> GenerateScene(SceneNode sceneTree, Math::Mat4x4 modelMatrix, bool mergeChilds = false);
+            /// @brief Meshes a list of models in parallel.
+            /// @return Returns the meshes in the same order as the models.
+            std::vector<Mesh> GenerateMeshes(const std::vector<VoxelModel> &_Models);
+
+            /// @brief Assembles the scene tree.
+            /// @param _Meshes: Meshes of all nodes and animation frames, in the order of the tree.
+            /// @param _Next: Index of the next mesh of _Meshes, which belongs to this node.
+            std::vector<Mesh> GenerateScene(SceneNode sceneTree, Math::Mat4x4 modelMatrix, bool mergeChilds, const std::vector<Mesh> &_Meshes, size_t &_Next);
+
+            /// @brief Generates the chunks of the model with the level of detail of ::SetLod.
+            /// @param _OnlyDirty: Only returns the selected chunks, which cover a dirty chunk, see ::GenerateChunks.
+            /// @return Returns the chunks in voxel space of _Mesh.
+            std::vector<SMeshChunk> GenerateLodChunks(VoxelModel _Mesh, bool _OnlyDirty = false);
+
+            /// @return Returns _Mesh followed by one downsampled model per level of ::SetLod. The levels are reused until the voxels of _Mesh change.
+            std::vector<VoxelModel> GetLodModels(VoxelModel _Mesh);
+
+            /// @return Returns the color palette of the model or nullptr. Only reads the textures of the model, so chunks may call it concurrently.
+            static Texture GetPalette(VoxelModel _Model);
+
+            /// @return Returns the uv of a color index. Without a palette the uv keeps the index itself, like CMeshBuilder::AddFace.
+            static Math::Vec2f GetColorUV(const Texture &_Palette, int _Color);
+
+            /// @return Returns true if ::SetLod enabled the level of detail.
+            inline bool HasLod() const
+            {
+                return !m_LodDistances.empty();
+            }
+
             CFrustum *m_Frustum;
+            Math::Vec3f m_LodViewer;
+            std::vector<float> m_LodDistances;
+            bool m_SmoothShading;
+            int m_SmoothingIterations;
+            bool m_AmbientOcclusion;
+            bool m_VertexDeduplication;
+
+        private:
+            struct SLodModels
+            {
+                std::weak_ptr<CVoxelModel> Model;   //!< Source model, detects a new model at the same address.
+                size_t Revision;                    //!< CVoxelSpace::revision of the source model, when the levels have been created.
+                std::vector<VoxelModel> Levels;     //!< Downsampled models, starting with level 1.
+            };
+
+            std::mutex m_ThreadPoolLock;
+            std::shared_ptr<CThreadPool> m_ThreadPool;
+
+            std::mutex m_LodModelsLock;
+            ankerl::unordered_dense::map<const CVoxelModel*, SLodModels> m_LodModels;    //!< Downsampled levels of each meshed model.
+
+            std::weak_ptr<CVoxelModel> m_CachedModel;                           //!< Model of the chunk cache.
+            VectoriMap<SMeshChunk> m_ChunkCache;                                //!< Mesh of each chunk, the key is the start of the chunk.
     };
 }
 
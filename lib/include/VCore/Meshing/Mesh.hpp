@@ -28,6 +28,9 @@
 #include <VCore/Math/Mat4x4.hpp>
 #include <VCore/Meshing/Material.hpp>
 #include <VCore/Formats/IVoxelFormat.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <VCore/Math/Vector.hpp>
@@ -44,12 +47,94 @@ namespace VCore
         Math::Vec3f Normal;
         Math::Vec2f UV;
 
+#ifdef VERTEX_AMBIENT_OCCLUSION
+        float AO = 1.f;     //!< Baked ambient occlusion, 1 means no occlusion.
+#endif
+
         inline bool operator==(const SVertex &_Vertex) const
         {
+#ifdef VERTEX_AMBIENT_OCCLUSION
+            if(_Vertex.AO != AO)
+                return false;
+#endif
             return _Vertex.Pos == Pos && _Vertex.Normal == Normal && _Vertex.UV == UV;
         }
     };
 
+    /**
+     * @brief Packed vertex, which is stored by the default vertex data if VERTEX_COMPACT is defined.
+     * The normal is octahedral encoded into 2 bytes and the uv is a 16 bit fixed point number in [0, 1], so a vertex needs 20 instead of 32 bytes.
+     * Axis aligned normals survive the encoding exactly.
+     * 
+     * @note Uvs outside of [0, 1] are clamped, so every uv of a compact mesh must be normalized.
+     */
+    struct SCompactVertex
+    {
+        SCompactVertex() = default;
+        SCompactVertex(const SVertex &_Vertex) : Pos(_Vertex.Pos)
+        {
+            float u = 0, v = 0;
+            float length = std::abs(_Vertex.Normal.x) + std::abs(_Vertex.Normal.y) + std::abs(_Vertex.Normal.z);
+            if(length != 0)
+            {
+                u = _Vertex.Normal.x / length;
+                v = _Vertex.Normal.y / length;
+                if(_Vertex.Normal.z < 0)
+                    FoldOctahedron(u, v);
+            }
+
+            Normal[0] = (int8_t)std::round(u * 127.f);
+            Normal[1] = (int8_t)std::round(v * 127.f);
+
+            UV[0] = (uint16_t)std::round(std::min(std::max(_Vertex.UV.x, 0.f), 1.f) * 65535.f);
+            UV[1] = (uint16_t)std::round(std::min(std::max(_Vertex.UV.y, 0.f), 1.f) * 65535.f);
+
+#ifdef VERTEX_AMBIENT_OCCLUSION
+            AO = (uint8_t)std::round(std::min(std::max(_Vertex.AO, 0.f), 1.f) * 255.f);
+#endif
+        }
+
+        Math::Vec3f Pos;
+        uint16_t UV[2];
+        int8_t Normal[2];
+
+#ifdef VERTEX_AMBIENT_OCCLUSION
+        uint8_t AO;
+#endif
+
+        operator SVertex() const
+        {
+            SVertex ret;
+            ret.Pos = Pos;
+            ret.UV = Math::Vec2f(UV[0] / 65535.f, UV[1] / 65535.f);
+
+            float u = Normal[0] / 127.f, v = Normal[1] / 127.f;
+            float w = 1.f - std::abs(u) - std::abs(v);
+            if(w < 0)
+                FoldOctahedron(u, v);
+
+            float length = std::sqrt(u * u + v * v + w * w);
+            if(length != 0)
+                ret.Normal = Math::Vec3f(u / length, v / length, w / length);
+
+#ifdef VERTEX_AMBIENT_OCCLUSION
+            ret.AO = AO / 255.f;
+#endif
+            return ret;
+        }
+
+        private:
+            /**
+             * @brief Mirrors the lower half of the octahedron onto the corners of the square and back.
+             */
+            static inline void FoldOctahedron(float &_U, float &_V)
+            {
+                float u = _U;
+                _U = (1.f - std::abs(_V)) * (u >= 0 ? 1.f : -1.f);
+                _V = (1.f - std::abs(u)) * (_V >= 0 ? 1.f : -1.f);
+            }
+    };
+
     struct SSurface
     {
         SSurface() {}
@@ -61,6 +146,7 @@ namespace VCore
 
         VERTEX_DATA                     //!< Vertices of this surface
         ADD_VERTEX_DATA_METHOD
+        RESERVE_VERTEX_DATA_METHOD
         GET_VERTEX_DATA_METHOD
         GET_VERTEX_STREAM_METHOD
         GET_VERTEX_DATA_SIZE_METHOD
@@ -99,7 +185,11 @@ namespace VCore
             size_t nh = v3fhasher(_Vertex.Normal);
             size_t uvh = v2fhasher(_Vertex.UV);
 
+#ifdef VERTEX_AMBIENT_OCCLUSION
+            return ((ph * 73856093) ^ (nh * 19349663) ^ (uvh * 83492791)) + (size_t)(_Vertex.AO * 3.f);
+#else
             return ((ph * 73856093) ^ (nh * 19349663) ^ (uvh * 83492791));
+#endif
         }
     };
 }
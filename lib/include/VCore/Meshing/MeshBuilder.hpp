@@ -25,11 +25,13 @@
 #ifndef MESHBUILDER_HPP
 #define MESHBUILDER_HPP
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <vector>
 #include <VCore/Formats/IVoxelFormat.hpp>
 #include <VCore/Meshing/Mesh.hpp>
+#include <VCore/Misc/ThreadPool.hpp>
 #include <VCore/Voxel/VoxelTextureMap.hpp>
 
 namespace VCore
@@ -37,7 +39,7 @@ namespace VCore
     class CMeshBuilder
     {
         public:
-            CMeshBuilder() : m_TextureMap(nullptr), m_CachedSurface(nullptr) {}
+            CMeshBuilder() : m_TextureMap(nullptr), m_CachedSurface(nullptr), m_VertexDeduplication(true), m_ChunkSize(16, 16, 16) {}
 
             /**
              * @brief Sets the texturing map.
@@ -47,6 +49,31 @@ namespace VCore
                 m_TextureMap = _Map;
             }
 
+            /**
+             * @brief Enables or disables the sharing of equal vertices by quads and by ::Merge. Triangles always share their vertices.
+             * Without it each quad appends its 4 vertices, so no vertex needs to be looked up in the hash map of its surface.
+             */
+            inline void SetVertexDeduplication(bool _Enable)
+            {
+                m_VertexDeduplication = _Enable;
+            }
+
+            /**
+             * @brief Sets the chunk size of the merged meshes. Only vertices near the chunk borders are welded by ::Merge, all others are unique within their chunk mesh.
+             */
+            inline void SetChunkSize(const Math::Vec3i &_ChunkSize)
+            {
+                m_ChunkSize = _ChunkSize;
+            }
+
+            /**
+             * @brief Sets the thread pool, which ::Merge uses to merge the meshes in parallel. Without a pool the meshes are merged on the calling thread.
+             */
+            inline void SetThreadPool(std::shared_ptr<CThreadPool> _Pool)
+            {
+                m_ThreadPool = _Pool;
+            }
+
             /**
              * @brief Adds all needed textures to the mesh. This must be called before AddFace
              * 
@@ -54,6 +81,12 @@ namespace VCore
              */
             void AddTextures(const std::map<TextureType, Texture> &_textures);
 
+            /**
+             * @brief Reserves memory for _Vertices more vertices and _Indices more indices in the surface of _Material.
+             * Meshers, which know their face count beforehand, should call this before AddFace, so the buffers don't grow face by face.
+             */
+            void Reserve(Material _Material, size_t _Vertices, size_t _Indices);
+
             /**
              * @brief Adds a new quad to the mesh.
              * 
@@ -64,10 +97,19 @@ namespace VCore
              * @param _normal: Face normal
              * @param _color: Color index of the face
              * @param _material: Material of the face
+             * @param _occlusion: Optional ambient occlusion of the 4 vertices, see the quad overload with vertices.
              * 
              * @throws CMeshBuilderException If AddTextures has not been previously called.
              */
-            void AddFace(Math::Vec3f _v1, Math::Vec3f _v2, Math::Vec3f _v3, Math::Vec3f _v4, Math::Vec3f _normal, int _color, Material _material);
+            void AddFace(Math::Vec3f _v1, Math::Vec3f _v2, Math::Vec3f _v3, Math::Vec3f _v4, Math::Vec3f _normal, int _color, Material _material, const uint8_t *_occlusion = nullptr);
+
+            /**
+             * @brief Adds a new quad with finished vertices. _v1 and _v4 are opposite corners, the winding follows the normal of the vertices.
+             * 
+             * @param _occlusion: Optional ambient occlusion of the 4 vertices, from 0 (fully occluded) to 3 (free). The quad is split along the brighter diagonal, so the occlusion is interpolated evenly.
+             * The value is only stored in the vertices if VERTEX_AMBIENT_OCCLUSION is defined.
+             */
+            void AddFace(SVertex _v1, SVertex _v2, SVertex _v3, SVertex _v4, Material _material, const uint8_t *_occlusion = nullptr);
 
             /**
              * @brief Adds a new triangle to the mesh.
@@ -75,7 +117,7 @@ namespace VCore
             void AddFace(SVertex v1, SVertex v2, SVertex v3, Material _material);
 
             /**
-             * @brief Merges a list of meshes into one.
+             * @brief Merges a list of meshes into one. Equal vertices near the chunk borders are welded, if the vertex deduplication is enabled.
              * @return Returns the _MergeInto mesh or a new one, if _MergeInto is null. 
              */
             Mesh Merge(Mesh _MergeInto, const std::vector<Mesh> &_Meshes, bool _ApplyModelMatrix = false);
@@ -87,6 +129,31 @@ namespace VCore
 
             ~CMeshBuilder() = default;
         private:
+            /**
+             * @brief Surface of a mesh, which is merged into the surface with the same material.
+             */
+            struct SMergePart
+            {
+                const SSurface *Surface;
+                Math::Mat4x4 *ModelMatrix;          //!< Transformation of the vertices, null if they keep their position.
+                Math::Mat4x4 *Rotation;             //!< Transformation of the normals.
+                std::vector<int> Remap;             //!< New index of each vertex of the part. -1 marks a vertex near the chunk border during the merge.
+                size_t BorderCount;                 //!< Count of vertices near the chunk border.
+                size_t FirstIndex;                  //!< Position of the indices of this part.
+                std::vector<int> *Target;           //!< Indices of the merged surface.
+
+                inline SVertex GetVertex(int _Idx) const
+                {
+                    SVertex v = (*Surface)[_Idx];
+                    if(ModelMatrix)
+                    {
+                        v.Pos = *ModelMatrix * v.Pos;
+                        v.Normal = *Rotation * v.Normal;
+                    }
+                    return v;
+                }
+            };
+
             struct SIndexedSurface
             {
                 SIndexedSurface(const Material &_Material) 
@@ -96,22 +163,30 @@ namespace VCore
 
                 ankerl::unordered_dense::map<SVertex, int, VertexHasher> Index;
                 SSurface Surface;
+                std::vector<SMergePart> MergeParts;
             };
 
+            SIndexedSurface &GetSurface(const Material &_Material);
             int AddVertex(const SVertex &_Vertex, SIndexedSurface &_Surface);
-            void AddMergeVertex(const SVertex &_Vertex, SIndexedSurface &_Surface, ankerl::unordered_dense::map<SVertex, int, VertexHasher> &_Index);
 
             bool IsOnBorder(const Math::Vec3f &_Pos);
 
-            void MergeIntoThis(Mesh m, bool _ApplyModelMatrix);
             void GenerateCache(Mesh _MergeInto);
+            void WeldParts(SIndexedSurface &_Surface);
+
+            /**
+             * @brief Calls _Fn(i) for all i in [0, _Count), in parallel if a thread pool has been set.
+             */
+            void RunParallel(size_t _Count, const std::function<void(size_t)> &_Fn);
 
             const std::map<TextureType, Texture> *m_Textures;
             ankerl::unordered_dense::map<size_t, SIndexedSurface> m_Surfaces;
-            Mesh m_MergerMesh;
 
             CVoxelTextureMap *m_TextureMap;
             SIndexedSurface *m_CachedSurface;
+            bool m_VertexDeduplication;
+            Math::Vec3i m_ChunkSize;
+            std::shared_ptr<CThreadPool> m_ThreadPool;
     };
 }
 
@@ -53,6 +53,11 @@ namespace VCore
 
             void AddRawPixels(const std::vector<CColor> &_Pixels, const Math::Vec2ui &_Position, const Math::Vec2ui &_Size);
 
+            /**
+             * @brief Copies a block of _Size RGBA pixels, which are stored row by row, to _Position.
+             */
+            void AddRawPixels(const uint32_t *_Pixels, const Math::Vec2ui &_Position, const Math::Vec2ui &_Size);
+
             inline Math::Vec2ui GetSize() const
             {
                 return m_Size;
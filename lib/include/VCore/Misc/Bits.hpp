@@ -0,0 +1,76 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BITS_HPP
+#define BITS_HPP
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace VCore
+{
+    /**
+     * @return Returns the index of the lowest set bit.
+     * @note _Value must not be zero.
+     */
+    inline int CountTrailingZeros(uint64_t _Value)
+    {
+#ifdef _MSC_VER
+        unsigned long idx;
+        _BitScanForward64(&idx, _Value);
+        return (int)idx;
+#else
+        return __builtin_ctzll(_Value);
+#endif
+    }
+
+    /**
+     * @return Returns the count of set bits.
+     */
+    inline int PopCount(uint64_t _Value)
+    {
+#ifdef _MSC_VER
+        return (int)__popcnt64(_Value);
+#else
+        return __builtin_popcountll(_Value);
+#endif
+    }
+
+    /**
+     * @return Returns a mask with all bits from _Beg to _End (inclusive) set.
+     */
+    inline uint64_t BitRange(int _Beg, int _End)
+    {
+        if(_End < _Beg)
+            return 0;
+
+        uint64_t upper = (_End >= 63) ? ~0ull : ((1ull << (_End + 1)) - 1);
+        return upper & ~((1ull << _Beg) - 1);
+    }
+}
+
+#endif //BITS_HPP
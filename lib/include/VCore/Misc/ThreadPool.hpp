@@ -0,0 +1,149 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace VCore
+{
+    /**
+     * @brief Persistent pool of worker threads.
+     * 
+     * Each worker owns a task queue. Workers take the newest task of their own queue and steal the oldest task of other queues, if their own queue is empty.
+     * Idle workers sleep until new tasks arrive.
+     */
+    class CThreadPool
+    {
+        public:
+            /**
+             * @param _ThreadCount: Count of worker threads. 0 creates one worker per core.
+             */
+            CThreadPool(size_t _ThreadCount = 0);
+            CThreadPool(const CThreadPool &_Other) = delete;
+
+            /**
+             * @brief Adds a new task to the pool.
+             * @return Returns a future, which receives the result of the task.
+             */
+            template<class Fn, class... Args>
+            std::future<typename std::invoke_result<Fn, Args...>::type> Enqueue(Fn &&_Fn, Args&&... _Args);
+
+            /**
+             * @brief Waits until the future is ready and returns its result.
+             * @note Runs pending tasks while waiting, so a task may wait for its own subtasks without blocking the pool.
+             */
+            template<class R>
+            R Wait(std::future<R> &_Future);
+
+            /**
+             * @return Returns the count of worker threads.
+             */
+            inline size_t GetThreadCount() const
+            {
+                return m_Workers.size();
+            }
+
+            CThreadPool &operator=(const CThreadPool &_Other) = delete;
+
+            ~CThreadPool();
+
+        private:
+            using Task = std::function<void()>;
+
+            struct SQueue
+            {
+                std::mutex Lock;
+                std::deque<Task> Tasks;
+            };
+
+            void Push(Task &&_Task);
+
+            /**
+             * @brief Runs a single pending task.
+             * @return Returns false if there was no pending task.
+             */
+            bool TryRun();
+
+            /**
+             * @brief Sleeps until a task is pending or a task has been finished.
+             */
+            void WaitForSignal(const std::function<bool()> &_Done);
+
+            void WorkerMain(size_t _Queue);
+
+            std::vector<std::unique_ptr<SQueue>> m_Queues;
+            std::vector<std::thread> m_Workers;
+            std::atomic<size_t> m_Pending;          //!< Count of queued tasks, which no thread has taken yet.
+            std::atomic<size_t> m_NextQueue;        //!< Round robin counter for tasks, which are added by none worker threads.
+
+            std::mutex m_SignalLock;
+            std::condition_variable m_WorkSignal;   //!< Wakes up workers on new tasks.
+            std::condition_variable m_DoneSignal;   //!< Wakes up threads inside ::Wait on new or finished tasks.
+            bool m_Stop;
+    };
+
+    //////////////////////////////////////////////////
+    // CThreadPool template functions
+    //////////////////////////////////////////////////
+
+    template<class Fn, class... Args>
+    inline std::future<typename std::invoke_result<Fn, Args...>::type> CThreadPool::Enqueue(Fn &&_Fn, Args&&... _Args)
+    {
+        using R = typename std::invoke_result<Fn, Args...>::type;
+
+        // std::function must be copyable, std::packaged_task isn't.
+        auto task = std::make_shared<std::packaged_task<R()>>(std::bind(std::forward<Fn>(_Fn), std::forward<Args>(_Args)...));
+        auto future = task->get_future();
+        Push([task]() { (*task)(); });
+
+        return future;
+    }
+
+    template<class R>
+    inline R CThreadPool::Wait(std::future<R> &_Future)
+    {
+        auto isReady = [&_Future]() { return _Future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; };
+        while(!isReady())
+        {
+            if(!TryRun())
+                WaitForSignal(isReady);
+        }
+
+        return _Future.get();
+    }
+}
+
+#endif //THREADPOOL_HPP
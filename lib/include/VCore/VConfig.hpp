@@ -25,14 +25,59 @@
 #ifndef VCONFIG_HPP
 #define VCONFIG_HPP
 
+// The following macros define the memory layout of a single voxel.
+
+/**
+ * @brief Stores the color and material index of a voxel in one byte each. A voxel shrinks from 8 to 4 bytes,
+ * but a model may use at most 255 colors and 255 materials.
+ * CVoxelModel::SetVoxel throws for larger indices and the loaders report palettes which don't fit.
+ */
+// #define VOXEL_COMPACT
+
+/**
+ * @brief Integer types of the color and material index of a voxel.
+ * @note The value -1 converted to the type marks an empty voxel, so it can't be used as an index.
+ */
+#ifndef VOXEL_COLOR_TYPE
+#ifdef VOXEL_COMPACT
+#define VOXEL_COLOR_TYPE uint8_t
+#else
+#define VOXEL_COLOR_TYPE int
+#endif
+#endif
+
+#ifndef VOXEL_MATERIAL_TYPE
+#ifdef VOXEL_COMPACT
+#define VOXEL_MATERIAL_TYPE uint8_t
+#else
+#define VOXEL_MATERIAL_TYPE short
+#endif
+#endif
+
+/**
+ * @brief Adds the member AO to SVertex, which receives the baked ambient occlusion of IMesher::SetAmbientOcclusion.
+ * 1 means no occlusion, 0 a fully occluded vertex.
+ */
+// #define VERTEX_AMBIENT_OCCLUSION
+
 // The following macros allow you to use your engine or framework's mesh data structures instead of the V-Core's.
 
+/**
+ * @brief Stores the vertices of the default vertex data as SCompactVertex. A vertex shrinks from 32 to 20 bytes,
+ * but its normal and uv are quantised. Uvs must lie in [0, 1]. Has no effect, if you define your own vertex data.
+ */
+// #define VERTEX_COMPACT
+
 /**
  * @brief Defines how data of a vertex should be stored.
  */
 #ifndef VERTEX_DATA
+#ifdef VERTEX_COMPACT
+#define VERTEX_DATA std::vector<SCompactVertex> Vertices;
+#else
 #define VERTEX_DATA std::vector<SVertex> Vertices;
 #endif
+#endif
 
 /**
  * @brief Defines how to move vertex data.
@@ -63,6 +108,17 @@
     }
 #endif
 
+/**
+ * @brief Defines how to reserve memory for a number of vertices, before they are added.
+ */
+#ifndef RESERVE_VERTEX_DATA_METHOD
+#define RESERVE_VERTEX_DATA_METHOD          \
+    void Reserve(size_t _Size)              \
+    {                                       \
+        Vertices.reserve(_Size);            \
+    }
+#endif
+
 /**
  * @brief Defines how to access a vertex by its index.
  */
@@ -78,10 +134,18 @@
  * @brief Allows certain exporters to get a stream of all the vertices.
  */
 #ifndef GET_VERTEX_STREAM_METHOD
+#ifdef VERTEX_COMPACT
+#define GET_VERTEX_STREAM_METHOD                                    \
+    std::vector<SVertex> GetVertices() const                        \
+    {                                                               \
+        return std::vector<SVertex>(Vertices.begin(), Vertices.end());  \
+    }
+#else
 #define GET_VERTEX_STREAM_METHOD                        \
     const std::vector<SVertex> &GetVertices() const     \
     {                                                   \
         return Vertices;                                \
     }
 #endif
+#endif
 #endif
\ No newline at end of file
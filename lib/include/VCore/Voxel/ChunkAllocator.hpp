@@ -0,0 +1,188 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHUNKALLOCATOR_HPP
+#define CHUNKALLOCATOR_HPP
+
+#include <VCore/Math/Vector.hpp>
+#include <VCore/Voxel/Voxel.hpp>
+
+#include <memory_resource>
+#include <vector>
+
+namespace VCore
+{
+    /**
+     * @brief Pool of equally sized memory blocks, which are cut out of larger slabs.
+     */
+    class CBlockPool
+    {
+        public:
+            CBlockPool() : m_BlockSize(0), m_BlocksPerSlab(0), m_Slab(0), m_Offset(0), m_FreeList(nullptr), m_Allocations(0), m_Frees(0) {}
+            CBlockPool(size_t _BlockSize);
+            CBlockPool(const CBlockPool &_Other) = delete;
+
+            /**
+             * @return Returns an uninitialized block.
+             */
+            void *alloc();
+
+            /**
+             * @brief Returns a block to the pool.
+             */
+            void free(void *_Block);
+
+            /**
+             * @brief Marks all blocks as free, without releasing the slabs.
+             */
+            void reset();
+
+            /**
+             * @return Returns how often ::alloc was called.
+             */
+            inline size_t allocations() const
+            {
+                return m_Allocations;
+            }
+
+            /**
+             * @return Returns how often ::free was called.
+             */
+            inline size_t frees() const
+            {
+                return m_Frees;
+            }
+
+            /**
+             * @return Returns the count of bytes reserved by all slabs.
+             */
+            inline size_t reservedBytes() const
+            {
+                return m_Slabs.size() * m_BlocksPerSlab * m_BlockSize;
+            }
+
+            CBlockPool &operator=(const CBlockPool &_Other) = delete;
+
+            ~CBlockPool();
+
+        private:
+            struct SFreeBlock
+            {
+                SFreeBlock *Next;
+            };
+
+            size_t m_BlockSize;
+            size_t m_BlocksPerSlab;
+
+            std::vector<char*> m_Slabs;
+            size_t m_Slab;              //!< Slab from which new blocks are cut.
+            size_t m_Offset;            //!< Index of the next unused block inside of m_Slab.
+            SFreeBlock *m_FreeList;     //!< Blocks which have been returned to the pool.
+
+            size_t m_Allocations;
+            size_t m_Frees;
+    };
+
+    /**
+     * @brief Allocates the voxel, row mask and plane count blocks and the sparse maps of all chunks of a CVoxelSpace.
+     */
+    class CChunkAllocator
+    {
+        public:
+            CChunkAllocator(const Math::Vec3i &_ChunkSize);
+            CChunkAllocator(const CChunkAllocator &_Other) = delete;
+
+            /**
+             * @return Returns a block of default constructed voxels, large enough for one chunk.
+             */
+            CVoxel *allocVoxels();
+            void freeVoxels(CVoxel *_Voxels);
+
+            /**
+             * @return Returns a zeroed block of row masks for one chunk.
+             */
+            uint64_t *allocRows();
+            void freeRows(uint64_t *_Rows);
+
+            /**
+             * @return Returns a zeroed block with one voxel counter for each x, y and z plane of a chunk.
+             */
+            uint32_t *allocPlanes();
+            void freePlanes(uint32_t *_Planes);
+
+            /**
+             * @return Returns the memory resource of the sparse voxel maps.
+             */
+            inline std::pmr::memory_resource *sparseResource()
+            {
+                return &m_Sparse;
+            }
+
+            /**
+             * @brief Marks all blocks as free in O(1) and releases the memory of all sparse maps. The blocks are kept for the next chunks.
+             * @note Blocks and sparse maps which are still in use must not be accessed or freed afterwards.
+             */
+            void reset();
+
+            /**
+             * @return Returns how many blocks have been allocated.
+             */
+            inline size_t allocations() const
+            {
+                return m_Voxels.allocations() + m_Rows.allocations() + m_Planes.allocations();
+            }
+
+            /**
+             * @return Returns how many blocks have been returned.
+             */
+            inline size_t frees() const
+            {
+                return m_Voxels.frees() + m_Rows.frees() + m_Planes.frees();
+            }
+
+            /**
+             * @return Returns the count of bytes reserved for the blocks, without the sparse maps.
+             */
+            inline size_t reservedBytes() const
+            {
+                return m_Voxels.reservedBytes() + m_Rows.reservedBytes() + m_Planes.reservedBytes();
+            }
+
+            CChunkAllocator &operator=(const CChunkAllocator &_Other) = delete;
+
+            ~CChunkAllocator() = default;
+
+        private:
+            size_t m_VoxelCount;
+            size_t m_RowCount;
+            size_t m_PlaneCount;
+
+            CBlockPool m_Voxels;
+            CBlockPool m_Rows;
+            CBlockPool m_Planes;
+            std::pmr::unsynchronized_pool_resource m_Sparse;
+    };
+}
+
+#endif
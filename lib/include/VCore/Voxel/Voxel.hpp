@@ -27,6 +27,9 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits>
+#include <type_traits>
+#include <VCore/VConfig.hpp>
 #include <VCore/Math/Vector.hpp>
 
 namespace VCore
@@ -34,6 +37,18 @@ namespace VCore
     class CVoxel
     {
         public:
+            using ColorIndex = VOXEL_COLOR_TYPE;
+            using MaterialIndex = VOXEL_MATERIAL_TYPE;
+
+            static constexpr ColorIndex EMPTY_COLOR = (ColorIndex)-1;
+            static constexpr MaterialIndex EMPTY_MATERIAL = (MaterialIndex)-1;
+
+            /**
+             * @brief Largest usable indices. For unsigned index types the maximum value is reserved for EMPTY_COLOR / EMPTY_MATERIAL.
+             */
+            static constexpr int MAX_COLOR_INDEX = (int)std::numeric_limits<ColorIndex>::max() - (std::is_signed<ColorIndex>::value ? 0 : 1);
+            static constexpr int MAX_MATERIAL_INDEX = (int)std::numeric_limits<MaterialIndex>::max() - (std::is_signed<MaterialIndex>::value ? 0 : 1);
+
             enum Visibility : uint8_t
             {
                 INVISIBLE = 0,
@@ -49,8 +64,8 @@ namespace VCore
 
             CVoxel();
 
-            int Color;      //!< Index of the color.
-            short Material;   //!< Index of the material.
+            ColorIndex Color;           //!< Index of the color.
+            MaterialIndex Material;     //!< Index of the material.
             
             Visibility VisibilityMask;
             bool Transparent;
@@ -74,7 +89,7 @@ namespace VCore
     // CVoxel functions
     //////////////////////////////////////////////////
 
-    inline CVoxel::CVoxel() : Color(-1), Material(-1), Transparent(false)
+    inline CVoxel::CVoxel() : Color(EMPTY_COLOR), Material(EMPTY_MATERIAL), Transparent(false)
     {
         VisibilityMask = Visibility::INVISIBLE;
     }
@@ -86,7 +101,7 @@ namespace VCore
 
     inline bool CVoxel::IsInstantiated() const
     {
-        return (Color != -1) && (Material != -1);
+        return (Color != EMPTY_COLOR) && (Material != EMPTY_MATERIAL);
     }
 
     //////////////////////////////////////////////////
@@ -48,6 +48,9 @@ namespace VCore
         TEXTURED    //!< Each ColorIdx of a voxel is an index to a tile in a texture atlas.
     };
 
+    class CVoxelModel;
+    using VoxelModel = std::shared_ptr<CVoxelModel>;
+
     class CVoxelModel
     {
         using VoxelData = CVoxelSpace;
@@ -83,9 +86,29 @@ namespace VCore
              * @param Material: Material index of the voxels material.
              * @param Color: Color index.
              * @param Transparent: Is the block transparent?
+             * 
+             * @throws std::out_of_range if an index is negative or exceeds CVoxel::MAX_MATERIAL_INDEX / CVoxel::MAX_COLOR_INDEX (254 with VOXEL_COMPACT).
              */
             void SetVoxel(const Math::Vec3i &Pos, int Material, int Color, bool Transparent);
 
+            /**
+             * @brief Sets a list of voxels at once. The visibility is calculated only once per chunk.
+             * 
+             * @param Voxels: List of positions and their voxel.
+             */
+            void SetVoxels(const std::vector<std::pair<Math::Vec3i, CVoxel>> &Voxels);
+
+            /**
+             * @brief Starts a bulk insert. All following ::SetVoxel calls only write the raw voxel data, until ::EndBulkInsert is called.
+             * @note Queries of the visibility are invalid until ::EndBulkInsert is called.
+             */
+            void BeginBulkInsert();
+
+            /**
+             * @brief Ends a bulk insert and calculates the visibility of all inserted voxels.
+             */
+            void EndBulkInsert();
+
             /**
              * @brief Removes a voxel on a given position
              * 
@@ -100,6 +123,7 @@ namespace VCore
 
             /**
              * @return Gets a voxel on a given position.
+             * @note The pointer is only valid until the next ::SetVoxel or ::RemoveVoxel inside the same chunk, see CVoxelSpace.
              */
             Voxel GetVoxel(const Math::Vec3i &Pos);
 
@@ -140,12 +164,27 @@ namespace VCore
                 return m_Voxels.size();
             }
 
+            /**
+             * @return Returns the count of bytes allocated for the voxel data.
+             */
+            inline size_t GetMemoryUsage() const
+            {
+                return m_Voxels.memoryUsage();
+            }
+
             /**
              * @brief Queries all visible voxels.
              * @param opaque: If true only opaque voxels are returned, otherwise only none opaque voxels are returned.
              */
             VectoriMap<Voxel> QueryVisible(bool opaque) const;
 
+            /**
+             * @brief Same as QueryVisible, but returns a flat list sorted by chunks, which needs far less memory than the map.
+             * @param opaque: If true only opaque voxels are returned, otherwise only none opaque voxels are returned.
+             * @param _Pool: Optional pool, which scans large models in parallel, e.g. the pool of a mesher.
+             */
+            std::vector<VoxelData::ppair> QueryVisibleList(bool opaque, std::shared_ptr<CThreadPool> _Pool = nullptr) const;
+
             /**
              * @return Gets a list of all chunks which has been modified.
              * @note Marks all chunks as processed.
@@ -161,13 +200,17 @@ namespace VCore
              * @return Returns all chunks inside of the frustum
              */
             VoxelData::querylist QueryChunks(const CFrustum *_Frustum) const;
+
+            /**
+             * @brief Creates a copy of this model, where each block of _Factor^3 voxels becomes one voxel.
+             * A block is set if any of its voxels is set. It gets the most common color and material of its visible voxels, so the surface keeps its look.
+             */
+            VoxelModel Downsample(int _Factor) const;
             
             ~CVoxelModel() = default;
         private:             
             VoxelData m_Voxels;
     };
-
-    using VoxelModel = std::shared_ptr<CVoxelModel>;
 }
 
 
@@ -29,20 +29,44 @@
 #include <VCore/Voxel/BBox.hpp>
 #include <VCore/Voxel/Voxel.hpp>
 #include <VCore/Voxel/Frustum.hpp>
+#include <VCore/Voxel/ChunkAllocator.hpp>
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace VCore
 {
     class CVoxelSpace;
     class CChunk;
+    class CThreadPool;
 
     struct SChunkMeta
     {
-        size_t UniqueId;            //!< Unique identifier of the chunks. Only changes, if the voxel mesh is resized.
+        size_t UniqueId;            //!< Unique identifier of the chunks, see ::MakeUniqueId. Only changes, if the voxel mesh is resized.
         const CChunk *Chunk;        //!< Chunk with is associated with this metadata.
         CBBox TotalBBox;            //!< The total bounding box of the chunk.
         CBBox InnerBBox;            //!< The bounding box of the model inside the chunk.
+
+        /**
+         * @brief Packs the chunk coordinates and the level of detail into one id.
+         * 
+         * @param _Position: Start of the chunk, a multiple of _ChunkSize.
+         * @param _ChunkSize: Size of the chunks.
+         * @param _Lod: Level of detail of the chunk.
+         * 
+         * @return Returns an id, which is unique for up to 2^20 chunks per axis and 16 levels of detail.
+         */
+        static inline size_t MakeUniqueId(const Math::Vec3i &_Position, const Math::Vec3i &_ChunkSize, int _Lod = 0)
+        {
+            const uint64_t mask = (1 << 20) - 1;
+            uint64_t ret = (uint64_t)(_Lod & 0xF) << 60;
+            for (int i = 0; i < 3; i++)
+                ret |= ((uint64_t)(_Position.v[i] / _ChunkSize.v[i]) & mask) << (20 * i);
+
+            return (size_t)ret;
+        }
     };
 
     class CVoxelSpaceIterator
@@ -52,8 +76,11 @@ namespace VCore
             using reference = std::pair<Math::Vec3i, Voxel>&;
             using pointer = pair*;
 
+            //! Marks an iterator, whose cursor must be looked up before it can be advanced.
+            static constexpr size_t NO_CURSOR = SIZE_MAX;
+
             CVoxelSpaceIterator();
-            CVoxelSpaceIterator(const CVoxelSpace *_Space, const CBBox &_InnerBox, const pair &_Pair);
+            CVoxelSpaceIterator(const CVoxelSpace *_Space, size_t _Chunk, size_t _Cursor, const pair &_Pair);
             CVoxelSpaceIterator(const CVoxelSpaceIterator &_Other);
             CVoxelSpaceIterator(CVoxelSpaceIterator &&_Other);
 
@@ -70,8 +97,11 @@ namespace VCore
             CVoxelSpaceIterator& operator=(CVoxelSpaceIterator &&_Other);
         
         private:
+            friend CVoxelSpace;
+
             const CVoxelSpace *m_Space;
-            CBBox m_InnerBox;
+            size_t m_Chunk;         //!< Index of the chunk inside the chunk map.
+            size_t m_Cursor;        //!< Cursor inside the chunk behind the current voxel, see CChunk::next.
             mutable pair m_Pair;
     };
 
@@ -86,7 +116,7 @@ namespace VCore
 
             CChunk() = delete;
             CChunk(const CChunk &_Other) = delete;
-            CChunk(const Math::Vec3i &_ChunkSize);
+            CChunk(const Math::Vec3i &_ChunkSize, CChunkAllocator *_Allocator);
             CChunk(CChunk &&_Other);
 
             /**
@@ -95,17 +125,45 @@ namespace VCore
              */
             bool insert(CVoxelSpace *_Space, const pair &_pair, const CBBox &_ChunkDim);
 
+            /**
+             * @brief Writes a voxel without updating the visibility of the voxel or of its neighbours.
+             * @note ::updateVisibility must be called afterwards.
+             * @return Returns true if a new voxel was created
+             */
+            bool rawInsert(const pair &_pair, const CBBox &_ChunkDim);
+
+            /**
+             * @brief Recalculates the visibility of all voxels inside the given region.
+             * @param _Region: Region in chunk local coordinates, the end is inclusive.
+             */
+            void updateVisibility(CVoxelSpace *_Space, const CBBox &_ChunkDim, const CBBox &_Region);
+
             /**
              * @brief Removes a voxel.
+             * @param _Cursor: Receives the cursor behind the removed voxel, see ::next.
              * 
-             * @return Returns a pair, which contains the information, if a voxel was removed and the next voxel in the chunk.
+             * @return Returns true if a voxel was removed.
+             */
+            bool erase(CVoxelSpace *_Space, const Math::Vec3i &_v, const CBBox &_ChunkDim, size_t &_Cursor);
+
+            /**
+             * @brief Returns the next visible voxel at or behind the cursor and moves the cursor behind it.
+             * @param _Cursor: Linear voxel index for dense chunks, index of the sparse entry otherwise. 0 starts with the first voxel.
+             * @return Returns the voxel or null, if there is no visible voxel left.
              */
-            std::pair<bool, ppair> erase(CVoxelSpace *_Space, const iterator &_it, const CBBox &_ChunkDim);
+            ppair next(size_t &_Cursor, const CBBox &_ChunkDim) const;
 
             /**
-             * @brief Returns the next voxel or null.
+             * @return Returns the cursor behind the voxel at the given position, see ::next.
              */
-            ppair next(const Math::Vec3i &_Position, const CBBox &_ChunkDim) const;
+            size_t cursorAfter(const Math::Vec3i &_v, const CBBox &_ChunkDim) const;
+
+            /**
+             * @brief Calls _Fn(const Math::Vec3i &_Position, Voxel _Voxel) for each visible voxel of this chunk.
+             * @note Dense chunks are walked in memory order and skip empty rows via the row masks.
+             */
+            template<class Fn>
+            void forEachVisible(const CBBox &_ChunkDim, Fn &&_Fn) const;
 
             /**
              * @brief Tries to find a voxel.
@@ -135,20 +193,163 @@ namespace VCore
                 return CBBox(m_InnerBBox.Beg + _Position, m_InnerBBox.End + _Position);
             }
 
+            /**
+             * @return Returns true if the chunk keeps bitmasks of its x-rows. Only chunks which are at most 64 voxels wide have row masks.
+             */
+            inline bool hasRowMasks() const
+            {
+                return m_OpaqueRows != nullptr;
+            }
+
+            /**
+             * @return Returns the bitmask of the row at (_Y, _Z) in chunk local coordinates. Bit x is set if the voxel at x is instantiated.
+             * @note Only valid if ::hasRowMasks() returns true.
+             */
+            inline uint64_t occupancy(int _Y, int _Z, const Math::Vec3i &_ChunkSize) const
+            {
+                size_t idx = _Y + _ChunkSize.y * _Z;
+                return m_OpaqueRows[idx] | m_TransparentRows[idx];
+            }
+
+            /**
+             * @return Same as ::occupancy, but only for opaque voxels.
+             */
+            inline uint64_t opaque(int _Y, int _Z, const Math::Vec3i &_ChunkSize) const
+            {
+                return m_OpaqueRows[_Y + _ChunkSize.y * _Z];
+            }
+
+            /**
+             * @return Same as ::occupancy, but only for transparent voxels.
+             */
+            inline uint64_t transparent(int _Y, int _Z, const Math::Vec3i &_ChunkSize) const
+            {
+                return m_TransparentRows[_Y + _ChunkSize.y * _Z];
+            }
+
+            /**
+             * @return Returns true if the voxels are stored as a full array, otherwise they are stored sparse.
+             */
+            inline bool isDense() const
+            {
+                return m_Data != nullptr;
+            }
+
+            /**
+             * @return Returns the count of voxels inside this chunk.
+             */
+            inline size_t size() const
+            {
+                return m_VoxelCount;
+            }
+
+            /**
+             * @return Returns the count of bytes allocated by this chunk.
+             */
+            size_t memoryUsage(const Math::Vec3i &_ChunkSize) const;
+
+            /**
+             * @brief Forgets all blocks without returning them to the allocator, so that the allocator can be reset at once afterwards.
+             */
+            void detach();
+
             CChunk &operator=(CChunk &&_Other);
             CChunk &operator=(const CChunk &_Other) = delete;
 
             ~CChunk() { clear(); }
 
         private:
+            using SparseMap = ankerl::unordered_dense::pmr::map<uint32_t, CVoxel>;
+
+            /**
+             * @return Returns the stored voxel at the given index or null, if the chunk is sparse and has no voxel there.
+             */
+            CVoxel *At(size_t _Idx) const;
+
+            /**
+             * @return Returns the voxel at the given index, creates an empty one if neccessary. May switch the chunk to the dense storage.
+             */
+            CVoxel &Emplace(size_t _Idx, const Math::Vec3i &_ChunkSize);
+
+            /**
+             * @brief Removes the voxel at the given index. May switch the chunk to the sparse storage.
+             */
+            void Remove(size_t _Idx, const Math::Vec3i &_ChunkSize);
+
+            /**
+             * @return Returns the chunk local position of a voxel index.
+             */
+            static inline Math::Vec3i Position(size_t _Idx, const Math::Vec3i &_ChunkSize)
+            {
+                return Math::Vec3i(_Idx % _ChunkSize.x, (_Idx / _ChunkSize.x) % _ChunkSize.y, _Idx / (_ChunkSize.x * _ChunkSize.y));
+            }
+
+            void MakeDense();
+            void MakeSparse(const Math::Vec3i &_ChunkSize);
+
             CVoxel *GetBlock(CVoxelSpace *_Space, const CBBox &_ChunkDim, const Math::Vec3i &_v);
-            bool HasVoxelOnPlane(int _Axis, const Math::Vec3i &_Pos, const Math::Vec3i &_ChunkSize);
+            bool UpdateRowVisibility(const Math::Vec3i &_ChunkSize, const CChunk *const _Neighbours[6], const Math::Vec3i &_Beg, const Math::Vec3i &_End);
+            void CountPlanes(const Math::Vec3i &_Pos, const Math::Vec3i &_ChunkSize, int _Delta);
             void CheckAndUpdateVisibility(CVoxelSpace *_Space, const CBBox &_ChunkDim, Voxel _ThisVoxel, const Math::Vec3i &_Pos, CVoxel::Visibility _This, CVoxel::Visibility _Other);
 
+            void SetRowBit(const Math::Vec3i &_Pos, const Math::Vec3i &_ChunkSize, bool _Transparent);
+            void ClearRowBit(const Math::Vec3i &_Pos, const Math::Vec3i &_ChunkSize);
+
             void clear();
 
-            CVoxel *m_Data;
+            CChunkAllocator *m_Allocator;   //!< Allocator of the owning voxel space.
+            CVoxel *m_Data;                 //!< Dense storage of all voxels, null if the chunk is sparse.
+            SparseMap m_Sparse;             //!< Sparse storage, maps the voxel index to the voxel. Only used if m_Data is null. Allocated from CChunkAllocator::sparseResource.
+            size_t m_VoxelCount;
             CBBox m_InnerBBox;
+            uint32_t *m_PlaneCounts;        //!< Voxel count of each x, y and z plane, one after another.
+
+            uint64_t *m_OpaqueRows;         //!< One bitmask per x-row of opaque voxels, indexed by y + size.y * z. Null if the chunk is wider than 64 voxels.
+            uint64_t *m_TransparentRows;    //!< Same as m_OpaqueRows for transparent voxels. Shares the block with m_OpaqueRows.
+    };
+
+    /**
+     * @brief Lookup helper, which caches the last visited chunk.
+     * 
+     * Each thread or caller should use its own accessor. Any insert or erase, which creates or removes a chunk, invalidates the cache automatically.
+     */
+    class CVoxelSpaceAccessor
+    {
+        public:
+            CVoxelSpaceAccessor() : m_Space(nullptr), m_Generation(0), m_LastChunk(nullptr), m_HasLast(false) {}
+            CVoxelSpaceAccessor(const CVoxelSpace *_Space) : m_Space(_Space), m_Generation(0), m_LastChunk(nullptr), m_HasLast(false) {}
+
+            /**
+             * @brief Tries to find a voxel.
+             * @return Returns the voxel or null.
+             */
+            Voxel find(const Math::Vec3i &_v);
+
+            /**
+             * @brief Tries to find a voxel.
+             * @param _Opaque: If true only opaque voxels are returned, otherwise only none opaque voxels are returned.
+             * @return Returns the voxel or null.
+             */
+            Voxel find(const Math::Vec3i &_v, bool _Opaque);
+
+            /**
+             * @brief Same as find. but only for visible voxels.
+             */
+            Voxel findVisible(const Math::Vec3i &_v);
+
+            /**
+             * @brief Same as find. but only for visible voxels.
+             */
+            Voxel findVisible(const Math::Vec3i &_v, bool _Opaque);
+
+        private:
+            const CChunk *GetChunk(const Math::Vec3i &_v, CBBox &_ChunkDim);
+
+            const CVoxelSpace *m_Space;
+            size_t m_Generation;
+            Math::Vec3i m_LastPosition;
+            const CChunk *m_LastChunk;
+            bool m_HasLast;
     };
 
     class CChunkQueryList
@@ -215,18 +416,30 @@ namespace VCore
             void *m_Userdata;
     };
 
+    /**
+     * @brief Chunked storage of the voxels of a model. Each chunk keeps its voxels either in a dense array or, while it is mostly empty, in a sparse map.
+     * 
+     * A voxel returned by ::find, ::queryVisible or an iterator is only valid until the next insert or erase in the same chunk. Inserting may grow the sparse map,
+     * erasing moves the last sparse entry into the freed slot and both may switch the chunk between the dense and the sparse storage, which moves all of its voxels.
+     * Dense chunks are iterated in order of their voxel index, sparse chunks in order of insertion.
+     */
     class CVoxelSpace
     {
         friend CVoxelSpaceIterator;
+        friend CVoxelSpaceAccessor;
         friend CChunk;
 
         public:
             using ppair = std::pair<Math::Vec3i, Voxel>;
             using pair = std::pair<Math::Vec3i, CVoxel>;
             using iterator = CVoxelSpaceIterator;
+            using accessor = CVoxelSpaceAccessor;
             using querylist = CChunkQueryList;
 
             CVoxelSpace();
+            /**
+             * @param _ChunkSize: Size of a single chunk. Each axis is rounded up to the next power of two.
+             */
             CVoxelSpace(const Math::Vec3i &_ChunkSize);
             CVoxelSpace(const CVoxelSpace &_Other) = delete;
             CVoxelSpace(CVoxelSpace &&_Other);
@@ -236,6 +449,22 @@ namespace VCore
              */
             void insert(const pair &_pair);
 
+            /**
+             * @brief Inserts a list of voxels and calculates their visibility afterwards in a single pass.
+             */
+            void insert(const std::vector<pair> &_pairs);
+
+            /**
+             * @brief Starts a bulk insert. Until ::endBulkInsert is called, ::insert only writes the raw voxel data.
+             * @note The visibility of the voxels is invalid until ::endBulkInsert is called.
+             */
+            void beginBulkInsert();
+
+            /**
+             * @brief Ends a bulk insert and recalculates the visibility of all touched chunks.
+             */
+            void endBulkInsert();
+
             /**
              * @brief Removes a voxel.
              */
@@ -244,6 +473,7 @@ namespace VCore
             /**
              * @brief Tries to find a voxel.
              * @return Returns an iterator to the voxel or ::end()
+             * @note The voxel is invalidated by any insert or erase in the same chunk.
              */
             iterator find(const Math::Vec3i &_v) const;
 
@@ -264,18 +494,41 @@ namespace VCore
              */
             iterator findVisible(const Math::Vec3i &_v, bool _Opaque) const;
 
+            /**
+             * @return Returns a new accessor, which caches the last visited chunk for a faster lookup of neighbouring voxels.
+             */
+            inline accessor createAccessor() const
+            {
+                return accessor(this);
+            }
+
             /**
              * @brief Queries all visible voxels.
              * @param opaque: If true only opaque voxels are returned, otherwise only none opaque voxels are returned.
              */
             VectoriMap<Voxel> queryVisible(bool opaque) const;
 
+            /**
+             * @brief Same as ::queryVisible, but returns a flat list sorted by chunks instead of a map.
+             * @param opaque: If true only opaque voxels are returned, otherwise only none opaque voxels are returned.
+             * @param _Pool: Optional pool, which scans the chunk ranges of large spaces in parallel. Without a pool the calling thread scans all chunks.
+             */
+            std::vector<ppair> queryVisibleList(bool opaque, std::shared_ptr<CThreadPool> _Pool = nullptr) const;
+
             /**
              * @return Gets a list of all chunks which has been modified.
              * @note Marks all chunks as processed.
              */
             querylist queryDirtyChunks() const;
 
+            /**
+             * @brief Marks every chunk as dirty, which lies within _Halo voxels of a dirty chunk.
+             * Meshers which read voxels around their chunk, e.g. for the occlusion or smooth surfaces, must remesh these neighbours as well, even if only a diagonal chunk has been modified.
+             * 
+             * @param _Halo: Count of voxels a mesher reads beyond the border of a chunk.
+             */
+            void expandDirtyChunks(int _Halo);
+
             /**
              * @brief Marks a dirty chunks as clean.
              */
@@ -299,9 +552,65 @@ namespace VCore
                 return m_VoxelsCount;
             }
 
+            /**
+             * @return Returns the count of bytes allocated by all chunks.
+             */
+            size_t memoryUsage() const;
+
+            /**
+             * @return Returns the allocator of the chunk blocks, e.g. to read its allocation counters.
+             */
+            inline const CChunkAllocator &allocator() const
+            {
+                return *m_Allocator;
+            }
+
+            /**
+             * @return Returns the count of chunks. Chunk ranges of ::forEachVisible are indices in [0, chunkCount()).
+             */
+            inline size_t chunkCount() const
+            {
+                return m_Chunks.size();
+            }
+
+            /**
+             * @return Returns a counter, which changes with every insert, erase or clear. Used to invalidate data derived from the voxels.
+             */
+            inline size_t revision() const
+            {
+                return m_Revision;
+            }
+
+            /**
+             * @return Returns the size of a single chunk.
+             */
+            inline const Math::Vec3i &chunkSize() const
+            {
+                return m_ChunkSize;
+            }
+
+            /**
+             * @brief Calls _Fn(const Math::Vec3i &_Position, Voxel _Voxel) for each visible voxel, chunk by chunk. No memory is allocated.
+             */
+            template<class Fn>
+            void forEachVisible(Fn &&_Fn) const
+            {
+                forEachVisible(0, m_Chunks.size(), _Fn);
+            }
+
+            /**
+             * @brief Same as ::forEachVisible, but only visits the chunks [_Beg, _End).
+             * @note Different threads may visit distinct ranges at the same time, as long as the space isn't modified.
+             */
+            template<class Fn>
+            void forEachVisible(size_t _Beg, size_t _End, Fn &&_Fn) const;
+
             iterator begin();
             iterator end() const;
 
+            /**
+             * @return Returns the bounding box of all voxels. The box is cached and only recalculated after a voxel on its border has been removed.
+             */
             CBBox calculateBBox() const;
 
             void clear();
@@ -315,12 +624,76 @@ namespace VCore
             CChunk *GetChunk(const Math::Vec3i &_Position);
 
             Math::Vec3i chunkpos(const Math::Vec3i &_Position) const;
-            iterator next(const Math::Vec3i &_FromPosition) const;
+
+            /**
+             * @return Returns the first visible voxel at or behind the cursor of the given chunk, continues with the following chunks.
+             */
+            iterator next(size_t _Chunk, size_t _Cursor) const;
 
             Math::Vec3i m_ChunkSize;
+            Math::Vec3i m_ChunkMask;        //!< m_ChunkSize - 1, used to calculate the chunk position.
             size_t m_VoxelsCount;
+            size_t m_Generation;            //!< Changes every time a chunk is created or removed.
+            size_t m_Revision;              //!< Changes with every insert, erase or clear.
+            std::unique_ptr<CChunkAllocator> m_Allocator;     //!< Heap allocated, so that the chunks keep a valid pointer if the space is moved.
             ankerl::unordered_dense::map<Math::Vec3i, CChunk, Math::Vec3iHasher> m_Chunks;
+
+            mutable std::mutex m_BBoxLock;
+            mutable CBBox m_BBox;           //!< Cached bounding box of all voxels, see ::calculateBBox.
+            mutable bool m_BBoxValid;
+
+            size_t m_BulkInsertDepth;
+            ankerl::unordered_dense::set<Math::Vec3i, Math::Vec3iHasher> m_BulkChunks;     //!< Chunks touched during a bulk insert.
     };
+
+    //////////////////////////////////////////////////
+    // CChunk template functions
+    //////////////////////////////////////////////////
+
+    template<class Fn>
+    inline void CChunk::forEachVisible(const CBBox &_ChunkDim, Fn &&_Fn) const
+    {
+        const Math::Vec3i &size = _ChunkDim.End;
+        if(!m_Data)
+        {
+            for (auto &&v : m_Sparse)
+            {
+                if(v.second.IsVisible())
+                    _Fn(_ChunkDim.Beg + Position(v.first, size), const_cast<CVoxel*>(&v.second));
+            }
+            return;
+        }
+
+        for (int z = m_InnerBBox.Beg.z; z <= m_InnerBBox.End.z; z++)
+        {
+            for (int y = m_InnerBBox.Beg.y; y <= m_InnerBBox.End.y; y++)
+            {
+                if(m_OpaqueRows && !occupancy(y, z, size))
+                    continue;
+
+                CVoxel *row = m_Data + size.x * y + size.x * size.y * z;
+                for (int x = m_InnerBBox.Beg.x; x <= m_InnerBBox.End.x; x++)
+                {
+                    if(row[x].IsVisible())
+                        _Fn(_ChunkDim.Beg + Math::Vec3i(x, y, z), &row[x]);
+                }
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////
+    // CVoxelSpace template functions
+    //////////////////////////////////////////////////
+
+    template<class Fn>
+    inline void CVoxelSpace::forEachVisible(size_t _Beg, size_t _End, Fn &&_Fn) const
+    {
+        auto &chunks = m_Chunks.values();
+        _End = std::min(_End, chunks.size());
+
+        for (size_t i = _Beg; i < _End; i++)
+            chunks[i].second.forEachVisible(CBBox(chunks[i].first, m_ChunkSize), _Fn);
+    }
 }
 
 
@@ -366,6 +366,11 @@ namespace VCore
         std::vector<int> indices;
         int indexOffset = 0;
 
+        // Compact meshes store each normal and uv only once and reference them per polygon vertex.
+        std::vector<int> vertexNormals, vertexUVs, normalIndices, uvIndices;
+        VectorMap<int> normalTable;
+        ankerl::unordered_dense::map<Math::Vec2f, int, Math::Vec2fHasher> uvTable;
+
         // Material polygon map.
         std::vector<int> materials;
 
@@ -385,6 +390,28 @@ namespace VCore
                 vertices.push_back(vertex.Pos.y);
                 vertices.push_back(vertex.Pos.z);
 
+                if(Settings->Compact)
+                {
+                    auto normal = normalTable.insert({vertex.Normal, (int)normalTable.size()});
+                    if(normal.second)
+                    {
+                        normals.push_back(vertex.Normal.x);
+                        normals.push_back(vertex.Normal.y);
+                        normals.push_back(vertex.Normal.z);
+                    }
+
+                    auto uv = uvTable.insert({vertex.UV, (int)uvTable.size()});
+                    if(uv.second)
+                    {
+                        uvs.push_back(vertex.UV.x);
+                        uvs.push_back(vertex.UV.y);
+                    }
+
+                    vertexNormals.push_back(normal.first->second);
+                    vertexUVs.push_back(uv.first->second);
+                    continue;
+                }
+
                 normals.push_back(vertex.Normal.x);
                 normals.push_back(vertex.Normal.y);
                 normals.push_back(vertex.Normal.z);
@@ -415,6 +442,12 @@ namespace VCore
             {
                 int idx = indexOffset + i;
 
+                if(Settings->Compact)
+                {
+                    normalIndices.push_back(vertexNormals[idx]);
+                    uvIndices.push_back(vertexUVs[idx]);
+                }
+
                 // The last index need to be xored by -1. Since we use triangles instead of quads its every third index.
                 if(counter % 3 == 0)
                 {
@@ -447,9 +480,19 @@ namespace VCore
         CFbxNode normalLayer("LayerElementNormal", { CFbxProperty(0) });
         normalLayer.AddSubNode("Version", { CFbxProperty(101) });
         normalLayer.AddSubNode("Name", { CFbxProperty("") });
-        normalLayer.AddSubNode("MappingInformationType", { CFbxProperty("ByVertice") });
-        normalLayer.AddSubNode("ReferenceInformationType", { CFbxProperty("Direct") });
-        normalLayer.AddSubNode("Normals", { CFbxProperty(normals) });
+        if(Settings->Compact)
+        {
+            normalLayer.AddSubNode("MappingInformationType", { CFbxProperty("ByPolygonVertex") });
+            normalLayer.AddSubNode("ReferenceInformationType", { CFbxProperty("IndexToDirect") });
+            normalLayer.AddSubNode("Normals", { CFbxProperty(normals) });
+            normalLayer.AddSubNode("NormalsIndex", { CFbxProperty(normalIndices) });
+        }
+        else
+        {
+            normalLayer.AddSubNode("MappingInformationType", { CFbxProperty("ByVertice") });
+            normalLayer.AddSubNode("ReferenceInformationType", { CFbxProperty("Direct") });
+            normalLayer.AddSubNode("Normals", { CFbxProperty(normals) });
+        }
         normalLayer.AddSubNode("", {});
         geometry.AddSubNode(std::move(normalLayer));
 
@@ -457,9 +500,19 @@ namespace VCore
         CFbxNode uvLayer("LayerElementUV", { CFbxProperty(0) });
         uvLayer.AddSubNode("Version", { CFbxProperty(101) });
         uvLayer.AddSubNode("Name", { CFbxProperty("UVMap") });
-        uvLayer.AddSubNode("MappingInformationType", { CFbxProperty("ByVertice") });
-        uvLayer.AddSubNode("ReferenceInformationType", { CFbxProperty("Direct") });
-        uvLayer.AddSubNode("UV", { CFbxProperty(uvs) });
+        if(Settings->Compact)
+        {
+            uvLayer.AddSubNode("MappingInformationType", { CFbxProperty("ByPolygonVertex") });
+            uvLayer.AddSubNode("ReferenceInformationType", { CFbxProperty("IndexToDirect") });
+            uvLayer.AddSubNode("UV", { CFbxProperty(uvs) });
+            uvLayer.AddSubNode("UVIndex", { CFbxProperty(uvIndices) });
+        }
+        else
+        {
+            uvLayer.AddSubNode("MappingInformationType", { CFbxProperty("ByVertice") });
+            uvLayer.AddSubNode("ReferenceInformationType", { CFbxProperty("Direct") });
+            uvLayer.AddSubNode("UV", { CFbxProperty(uvs) });
+        }
         uvLayer.AddSubNode("", {});
         geometry.AddSubNode(std::move(uvLayer));
 
@@ -23,6 +23,8 @@
  */
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
 #include "Nodes.hpp"
 #include <sstream>
@@ -32,6 +34,84 @@
 
 namespace VCore
 {
+    /**
+     * @brief Interleaved layout of the vertices of one surface. Defaults to the layout of SVertex.
+     */
+    struct SVertexLayout
+    {
+        GLTF::GLTFTypes PositionType = GLTF::GLTFTypes::FLOAT;
+        GLTF::GLTFTypes NormalType = GLTF::GLTFTypes::FLOAT;
+        GLTF::GLTFTypes UVType = GLTF::GLTFTypes::FLOAT;
+
+        size_t NormalOffset = sizeof(Math::Vec3f);
+        size_t UVOffset = sizeof(Math::Vec3f) * 2;
+        size_t Stride = sizeof(SVertex);
+        size_t IndexSize = sizeof(int);
+    };
+
+    /**
+     * @brief Picks the smallest types of KHR_mesh_quantization, which still store the surface losslessly, apart from the normals and uvs.
+     * Positions are only stored as short, if all of them lie on the voxel grid.
+     */
+    static SVertexLayout GetCompactLayout(const SSurface &_Surface, const std::vector<SVertex> &_Vertices)
+    {
+        bool gridAligned = true, normalizedUV = true;
+        for (auto &&v : _Vertices)
+        {
+            for (size_t i = 0; i < 3 && gridAligned; i++)
+                gridAligned = v.Pos.v[i] == std::floor(v.Pos.v[i]) && v.Pos.v[i] >= INT16_MIN && v.Pos.v[i] <= INT16_MAX;
+
+            normalizedUV = normalizedUV && v.UV.x >= 0 && v.UV.x <= 1 && v.UV.y >= 0 && v.UV.y <= 1;
+        }
+
+        // Components of an attribute must start on a 4 byte boundary, so the shorts of the position are padded to 8 bytes.
+        SVertexLayout layout;
+        size_t positionSize = gridAligned ? sizeof(int16_t) * 4 : sizeof(Math::Vec3f);
+        size_t uvSize = normalizedUV ? sizeof(uint16_t) * 2 : sizeof(Math::Vec2f);
+
+        layout.PositionType = gridAligned ? GLTF::GLTFTypes::SHORT : GLTF::GLTFTypes::FLOAT;
+        layout.NormalType = GLTF::GLTFTypes::BYTE;
+        layout.UVType = normalizedUV ? GLTF::GLTFTypes::UNSIGNED_SHORT : GLTF::GLTFTypes::FLOAT;
+
+        layout.NormalOffset = positionSize;
+        layout.UVOffset = positionSize + sizeof(int8_t) * 4;
+        layout.Stride = layout.UVOffset + uvSize;
+
+        // The largest value of the index type is reserved for primitive restart.
+        layout.IndexSize = _Surface.Size() < UINT16_MAX ? sizeof(uint16_t) : sizeof(int);
+        return layout;
+    }
+
+    static void WriteCompactVertices(char *_Data, const SVertexLayout &_Layout, const std::vector<SVertex> &_Vertices)
+    {
+        for (auto &&v : _Vertices)
+        {
+            if(_Layout.PositionType == GLTF::GLTFTypes::SHORT)
+            {
+                int16_t *pos = (int16_t*)_Data;
+                for (size_t i = 0; i < 3; i++)
+                    pos[i] = (int16_t)v.Pos.v[i];
+            }
+            else
+                memcpy(_Data, v.Pos.v, sizeof(Math::Vec3f));
+
+            int8_t *normal = (int8_t*)(_Data + _Layout.NormalOffset);
+            for (size_t i = 0; i < 3; i++)
+                normal[i] = (int8_t)std::round(v.Normal.v[i] * 127.f);
+
+            if(_Layout.UVType == GLTF::GLTFTypes::UNSIGNED_SHORT)
+            {
+                uint16_t *uv = (uint16_t*)(_Data + _Layout.UVOffset);
+                uv[0] = (uint16_t)std::round(v.UV.x * 65535.f);
+                uv[1] = (uint16_t)std::round(v.UV.y * 65535.f);
+            }
+            else
+                memcpy(_Data + _Layout.UVOffset, v.UV.v, sizeof(Math::Vec2f));
+
+            _Data += _Layout.Stride;
+        }
+    }
+
     void CGLTFExporter::WriteData(const std::string &_Path, const std::vector<Mesh> &_Meshes)
     {
         auto filenameWithoutExt = GetFilenameWithoutExt(_Path);
@@ -48,6 +128,7 @@ namespace VCore
         size_t matId = 0;
 
         size_t animationRootIdx = -1;
+        bool quantised = false;
 
         for (auto &&mesh : _Meshes)
         {
@@ -85,16 +166,7 @@ namespace VCore
 
                 GLTF::CBufferView surfaceVerticesView, indexView;
 
-                auto vertices = surface.GetVertices();
-
-                surfaceVerticesView.Size = vertices.size() * sizeof(SVertex);
-                surfaceVerticesView.Target = GLTF::BufferTarget::ARRAY_BUFFER;
-                surfaceVerticesView.ByteStride = sizeof(SVertex);
-                surfaceVerticesView.Offset = binary.size();
-
-                indexView.Offset = surfaceVerticesView.Offset + surfaceVerticesView.Size;//uv.Size;
-                indexView.Size = surface.Indices.size() * sizeof(int);
-                indexView.Target = GLTF::BufferTarget::ELEMENT_ARRAY_BUFFER;
+                const auto &vertices = surface.GetVertices();
 
                 for (auto &&v : vertices)
                 {
@@ -102,31 +174,49 @@ namespace VCore
                     min = v.Pos.min(min);
                 }
 
+                SVertexLayout layout;
+                if(Settings->Compact)
+                    layout = GetCompactLayout(surface, vertices);
+
+                surfaceVerticesView.Size = vertices.size() * layout.Stride;
+                surfaceVerticesView.Target = GLTF::BufferTarget::ARRAY_BUFFER;
+                surfaceVerticesView.ByteStride = layout.Stride;
+                surfaceVerticesView.Offset = binary.size();
+
+                indexView.Offset = surfaceVerticesView.Offset + surfaceVerticesView.Size;//uv.Size;
+                indexView.Size = surface.Indices.size() * layout.IndexSize;
+                indexView.Target = GLTF::BufferTarget::ELEMENT_ARRAY_BUFFER;
+
                 GLTF::CAccessor positionAccessor, normalAccessor, uvAccessor, indexAccessor;
                 positionAccessor.BufferView = bufferViews.size();
-                positionAccessor.ComponentType = GLTF::GLTFTypes::FLOAT;
+                positionAccessor.ComponentType = layout.PositionType;
                 positionAccessor.Count = vertices.size();
                 positionAccessor.Type = "VEC3";
                 positionAccessor.SetMin(min);
                 positionAccessor.SetMax(max);
 
                 normalAccessor.BufferView = bufferViews.size();
-                normalAccessor.ComponentType = GLTF::GLTFTypes::FLOAT;
+                normalAccessor.ComponentType = layout.NormalType;
+                normalAccessor.Normalized = layout.NormalType != GLTF::GLTFTypes::FLOAT;
                 normalAccessor.Count = vertices.size();
                 normalAccessor.Type = "VEC3";
-                normalAccessor.Offset = sizeof(Math::Vec3f);
+                normalAccessor.Offset = layout.NormalOffset;
 
                 uvAccessor.BufferView = bufferViews.size();
-                uvAccessor.ComponentType = GLTF::GLTFTypes::FLOAT;
+                uvAccessor.ComponentType = layout.UVType;
+                uvAccessor.Normalized = layout.UVType != GLTF::GLTFTypes::FLOAT;
                 uvAccessor.Count = vertices.size();
                 uvAccessor.Type = "VEC2";
-                uvAccessor.Offset = normalAccessor.Offset + sizeof(Math::Vec3f);
+                uvAccessor.Offset = layout.UVOffset;
 
                 indexAccessor.BufferView = bufferViews.size() + 1;
-                indexAccessor.ComponentType = GLTF::GLTFTypes::INT;
+                indexAccessor.ComponentType = layout.IndexSize == sizeof(uint16_t) ? GLTF::GLTFTypes::UNSIGNED_SHORT : GLTF::GLTFTypes::INT;
                 indexAccessor.Count = surface.Indices.size();
                 indexAccessor.Type = "SCALAR";
 
+                if(layout.PositionType != GLTF::GLTFTypes::FLOAT || layout.NormalType != GLTF::GLTFTypes::FLOAT || layout.UVType != GLTF::GLTFTypes::FLOAT)
+                    quantised = true;
+
                 GLTF::CPrimitive Primitive;
                 Primitive.PositionAccessor = accessors.size();
                 Primitive.NormalAccessor = accessors.size() + 1;
@@ -147,12 +237,23 @@ namespace VCore
 
                 size_t pos = binary.size();
 
-                binary.resize(binary.size() + surfaceVerticesView.Size + indexView.Size);
+                // The next buffer view must start on a 4 byte boundary, which 16 bit indices may miss.
+                binary.resize(binary.size() + surfaceVerticesView.Size + ((indexView.Size + 3) & ~(size_t)3), '\0');
 
-                memcpy(binary.data() + pos, vertices.data(), surfaceVerticesView.Size);
+                if(!Settings->Compact)
+                    memcpy(binary.data() + pos, vertices.data(), surfaceVerticesView.Size);
+                else
+                    WriteCompactVertices(binary.data() + pos, layout, vertices);
                 pos += surfaceVerticesView.Size;
 
-                memcpy(binary.data() + pos, surface.Indices.data(), indexView.Size);
+                if(layout.IndexSize == sizeof(int))
+                    memcpy(binary.data() + pos, surface.Indices.data(), indexView.Size);
+                else
+                {
+                    uint16_t *indices = (uint16_t*)(binary.data() + pos);
+                    for (size_t i = 0; i < surface.Indices.size(); i++)
+                        indices[i] = (uint16_t)surface.Indices[i];
+                }
             }
         
             glTFMeshes.push_back(GLTFMesh);
@@ -238,6 +339,13 @@ namespace VCore
 
         json.AddPair("textures", gltfTextures);   
         json.AddPair("buffers", std::vector<GLTF::CBuffer>() = { Buffer });
+
+        if(quantised)
+        {
+            std::vector<std::string> extensions = { "KHR_mesh_quantization" };
+            json.AddPair("extensionsUsed", extensions);
+            json.AddPair("extensionsRequired", extensions);
+        }
         
         std::string JS = json.Serialize();
         if(!Settings->Binary)
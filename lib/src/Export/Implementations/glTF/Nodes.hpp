@@ -37,6 +37,9 @@ namespace VCore
     {
         enum GLTFTypes
         {
+            BYTE = 5120,
+            SHORT = 5122,
+            UNSIGNED_SHORT = 5123,
             FLOAT = 5126,
             INT = 5125
         };
@@ -165,13 +168,14 @@ namespace VCore
         class CAccessor
         {
             public:
-                CAccessor() : BufferView(0), ComponentType(GLTFTypes::FLOAT), Count(0), Offset(0) {}
+                CAccessor() : BufferView(0), ComponentType(GLTFTypes::FLOAT), Count(0), Offset(0), Normalized(false) {}
 
                 size_t BufferView;
                 GLTFTypes ComponentType;
                 std::string Type;
                 size_t Count;
                 size_t Offset;
+                bool Normalized;    //!< Maps integer components to [0, 1] or [-1, 1].
 
                 inline void SetMax(Math::Vec3f Max)
                 {
@@ -201,6 +205,9 @@ namespace VCore
                     if(Offset != 0)
                         json.AddPair("byteOffset", Offset);
 
+                    if(Normalized)
+                        json.AddPair("normalized", true);
+
                     if(!m_Max.empty())
                         json.AddPair("max", m_Max);
 
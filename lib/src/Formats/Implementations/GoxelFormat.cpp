@@ -52,6 +52,7 @@ namespace VCore
             auto size = m_BBox.End + m_BBox.Beg.abs();
             std::map<int, int> meshMaterialMapping;
 
+            m->BeginBulkInsert();
             for (auto &&b : l.Blocks)
             {
                 Math::Vec3f v = b.Pos;
@@ -141,6 +142,7 @@ namespace VCore
                     }
                 }
             }
+            m->EndBulkInsert();
 
             auto sceneNode = std::make_shared<CSceneNode>();
 
@@ -70,6 +70,7 @@ namespace VCore
         Pos.y = Content->Size.y - 1;
         Pos.z = (int)(Content->Size.z / 2.f);
 
+        m->BeginBulkInsert();
         for (auto &&tile : Content->Tiles)
         {
             if(tile->ColorIdx != -1)
@@ -96,6 +97,7 @@ namespace VCore
                 Pos.x++;
             }
         }
+        m->EndBulkInsert();
 
         auto sceneNode = std::make_shared<CSceneNode>();
         m_SceneTree->AddChild(sceneNode);
@@ -236,6 +236,7 @@ namespace VCore
         // Each model has it's used material attached, so we need to map the MagicaVoxel ID to the local one of the mesh.
         std::map<int, int> modelMaterialMapping;
 
+        m->BeginBulkInsert();
         for (int i = 0; i < VoxelCount; i++)
         {
             Math::Vec3i vec;
@@ -287,6 +288,7 @@ namespace VCore
 
             m->SetVoxel(vec, MatIdx, Color, Transparent);
         }
+        m->EndBulkInsert();
     }
 
     std::vector<std::vector<CMagicaVoxelFormat::SFrame>> CMagicaVoxelFormat::ProcessMaterialAndSceneGraph()
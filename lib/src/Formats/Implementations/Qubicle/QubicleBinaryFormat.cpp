@@ -63,10 +63,12 @@ namespace VCore
             sceneNode->Mesh = mesh;
             m_SceneTree->AddChild(sceneNode);
 
+            mesh->BeginBulkInsert();
             if(m_Header.Compression == 0)
                 ReadUncompressed(mesh, size);
             else
                 ReadRLECompressed(mesh, size);
+            mesh->EndBulkInsert();
 
             m_Models.push_back(mesh);
         }
@@ -178,6 +180,9 @@ namespace VCore
         auto IT = m_ColorIdx.find(color);
         if(IT == m_ColorIdx.end())
         {
+            if(m_ColorIdx.size() > (size_t)CVoxel::MAX_COLOR_INDEX)
+                throw CVoxelLoaderException("Model uses more than " + std::to_string((int64_t)CVoxel::MAX_COLOR_INDEX + 1) + " colors!");
+
             auto texIT = m_Textures.find(TextureType::DIFFIUSE);
             if(texIT == m_Textures.end())
                 m_Textures[TextureType::DIFFIUSE] = std::make_shared<CTexture>();
@@ -138,6 +138,7 @@ namespace VCore
         char *Data = stbi_zlib_decode_malloc(data.data(), dataSize, &OutSize);
         int strmPos = 0;
 
+        mesh->BeginBulkInsert();
         for (uint32_t x = 0; x < (uint32_t)size.x; x++)
         {
             for (uint32_t z = 0; z < (uint32_t)size.z; z++)
@@ -163,6 +164,7 @@ namespace VCore
                 }
             }
         }
+        mesh->EndBulkInsert();
         free(Data);
 
         m_Models.push_back(mesh);
@@ -198,6 +200,7 @@ namespace VCore
         char *Data = stbi_zlib_decode_malloc(data.data(), dataSize, &OutSize);
         int strmPos = 0;
 
+        mesh->BeginBulkInsert();
         for (uint32_t x = 0; x < (uint32_t)size.x; x++)
         {
             for (uint32_t z = 0; z < (uint32_t)size.z; z++)
@@ -223,6 +226,7 @@ namespace VCore
                 }
             }
         }
+        mesh->EndBulkInsert();
         free(Data);
 
         m_Models.push_back(mesh);
@@ -258,6 +262,9 @@ namespace VCore
         auto IT = m_ColorIdx.find(color);
         if(IT == m_ColorIdx.end())
         {
+            if(m_ColorIdx.size() > (size_t)CVoxel::MAX_COLOR_INDEX)
+                throw CVoxelLoaderException("Model uses more than " + std::to_string((int64_t)CVoxel::MAX_COLOR_INDEX + 1) + " colors!");
+
             auto texIT = m_Textures.find(TextureType::DIFFIUSE);
             if(texIT == m_Textures.end())
                 m_Textures[TextureType::DIFFIUSE] = std::make_shared<CTexture>();
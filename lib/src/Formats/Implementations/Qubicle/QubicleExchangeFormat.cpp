@@ -43,7 +43,9 @@ namespace VCore
         mesh->Materials = m_Materials;
         ReadVector();
         ReadColors();
+        mesh->BeginBulkInsert();
         ReadVoxels(mesh);
+        mesh->EndBulkInsert();
 
         auto sceneNode = std::make_shared<CSceneNode>();
         sceneNode->Mesh = mesh;
@@ -150,6 +150,7 @@ namespace VCore
         int strmPos = 0;
 
         uint32_t index = 0;
+        mesh->BeginBulkInsert();
         while(strmPos < OutSize)
         {
             uint32_t y = 0; 
@@ -200,6 +201,7 @@ namespace VCore
 
             index++;
         }
+        mesh->EndBulkInsert();
         free(Data);
 
         m_Models.push_back(mesh);
@@ -236,6 +238,9 @@ namespace VCore
         auto IT = m_ColorIdx.find(color);
         if(IT == m_ColorIdx.end())
         {
+            if(m_ColorIdx.size() > (size_t)CVoxel::MAX_COLOR_INDEX)
+                throw CVoxelLoaderException("Model uses more than " + std::to_string((int64_t)CVoxel::MAX_COLOR_INDEX + 1) + " colors!");
+
             auto texIT = m_Textures.find(TextureType::DIFFIUSE);
             if(texIT == m_Textures.end())
                 m_Textures[TextureType::DIFFIUSE] = std::make_shared<CTexture>();
@@ -27,40 +27,133 @@
 #include "Implementations/GreedyMesher.hpp"
 #include <VCore/Meshing/IMesher.hpp>
 #include "Implementations/MarchingCubesMesher.hpp"
+#include "Implementations/MaskGreedyMesher.hpp"
 #include <VCore/Meshing/MeshBuilder.hpp>
 #include "Implementations/SimpleMesher.hpp"
-#include <future>
+#include "Implementations/SurfaceNetsMesher.hpp"
+#include <algorithm>
+#include <functional>
+#include <map>
 
 namespace VCore
 {
-    template<typename R>
-    bool is_ready(std::future<R> const& f)
-    { return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+    /**
+     * @brief Collects the models of all nodes in the same order as GenerateScene visits them.
+     */
+    static void CollectSceneModels(const SceneNode &_Node, std::vector<VoxelModel> &_Models)
+    {
+        if(_Node->Mesh)
+            _Models.push_back(_Node->Mesh);
+        else if(_Node->Animation)
+        {
+            for (size_t i = 0; i < _Node->Animation->GetFrameCount(); i++)
+                _Models.push_back(_Node->Animation->GetFrame(i).Model);
+        }
+
+        for (auto &&child : *_Node)
+            CollectSceneModels(child, _Models);
+    }
+
+    /**
+     * @brief Scales all vertices of the mesh.
+     */
+    static Mesh ScaleMesh(Mesh _Mesh, int _Scale)
+    {
+        if(!_Mesh)
+            return _Mesh;
+
+        CMeshBuilder builder;
+        builder.AddTextures(_Mesh->Textures);
+
+        for (auto &&surface : _Mesh->Surfaces)
+        {
+            for (size_t i = 0; i < surface.Indices.size(); i += 3)
+            {
+                SVertex v1 = surface[surface.Indices[i]];
+                SVertex v2 = surface[surface.Indices[i + 1]];
+                SVertex v3 = surface[surface.Indices[i + 2]];
+
+                v1.Pos = v1.Pos * (float)_Scale;
+                v2.Pos = v2.Pos * (float)_Scale;
+                v3.Pos = v3.Pos * (float)_Scale;
+
+                builder.AddFace(v1, v2, v3, surface.FaceMaterial);
+            }
+        }
+
+        auto ret = builder.Build();
+        ret->Name = _Mesh->Name;
+        return ret;
+    }
 
     std::vector<Mesh> IMesher::GenerateScene(SceneNode sceneTree, bool mergeChilds)
     {
-        return GenerateScene(sceneTree, Math::Mat4x4(), mergeChilds);
+        std::vector<VoxelModel> models;
+        CollectSceneModels(sceneTree, models);
+
+        // All nodes and frames are meshed at once, the scene is assembled afterwards in the order of the tree.
+        auto meshes = GenerateMeshes(models);
+        size_t next = 0;
+
+        return GenerateScene(sceneTree, Math::Mat4x4(), mergeChilds, meshes, next);
     }
 
     std::vector<Mesh> IMesher::GenerateAnimation(VoxelAnimation _Anim)
     {
-        std::vector<Mesh> ret;
-
+        std::vector<VoxelModel> models;
         for (size_t i = 0; i < _Anim->GetFrameCount(); i++)
+            models.push_back(_Anim->GetFrame(i).Model);
+
+        auto ret = GenerateMeshes(models);
+        for (size_t i = 0; i < ret.size(); i++)
         {
-            auto voxelFrame = _Anim->GetFrame(i);
+            if(ret[i])
+                ret[i]->FrameTime = _Anim->GetFrame(i).FrameTime;
+        }
 
-            auto mesh = GenerateMesh(voxelFrame.Model);
-            mesh->FrameTime = voxelFrame.FrameTime;
+        return ret;
+    }
+
+    std::vector<Mesh> IMesher::GenerateMeshes(const std::vector<VoxelModel> &_Models)
+    {
+        // A model may be used by several nodes. Its occurrences are meshed one after another by the same task, since meshing marks the chunks of a model as processed.
+        std::vector<std::vector<size_t>> groups;
+        std::map<const CVoxelModel*, size_t> groupOfModel;
+        for (size_t i = 0; i < _Models.size(); i++)
+        {
+            auto it = groupOfModel.find(_Models[i].get());
+            if(it == groupOfModel.end())
+            {
+                it = groupOfModel.insert({_Models[i].get(), groups.size()}).first;
+                groups.emplace_back();
+            }
 
-            ret.push_back(mesh);
+            groups[it->second].push_back(i);
         }
 
+        std::vector<Mesh> ret(_Models.size());
+        auto pool = GetThreadPool();
+        std::vector<std::future<void>> futures;
+        for (auto &&group : groups)
+        {
+            futures.push_back(pool->Enqueue([this, &_Models, &ret, &group]()
+            {
+                for (size_t idx : group)
+                    ret[idx] = GenerateMesh(_Models[idx]);
+            }));
+        }
+
+        for (auto &&f : futures)
+            pool->Wait(f);
+
         return ret;
     }
 
     std::vector<SMeshChunk> IMesher::GenerateChunks(VoxelModel _Mesh, bool _OnlyDirty)
     {
+        if(HasLod())
+            return GenerateLodChunks(_Mesh, _OnlyDirty);
+
         std::vector<SMeshChunk> ret;
 
         CVoxelSpace::querylist chunks;
@@ -71,40 +164,26 @@ namespace VCore
             if(!_OnlyDirty)
                 chunks = _Mesh->QueryChunks();
             else
+            {
+                _Mesh->GetVoxels().expandDirtyChunks(GetHaloRadius());
                 chunks = _Mesh->QueryDirtyChunks();
+            }
         }
 
+        auto pool = GetThreadPool();
         std::vector<std::future<SMeshChunk>> futures;
         for (auto &&c : chunks)
         {
             _Mesh->GetVoxels().markAsProcessed(c);
-            futures.push_back(std::async(&IMesher::GenerateMeshChunk, this, _Mesh, c, true));
-            while(futures.size() >= std::thread::hardware_concurrency())
-            {
-                auto it = futures.begin();
-                while (it != futures.end())
-                {
-                    if(is_ready(*it))
-                    {
-                        auto result = it->get();
-                        result.MeshData->FrameTime = 0;
-                        ret.push_back(result);                        
-                        it = futures.erase(it);
-                    }
-                    else
-                        it++;
-                }
-            }
+            futures.push_back(pool->Enqueue(&IMesher::GenerateMeshChunk, this, _Mesh, c, true));
         }
 
-        auto it = futures.begin();
-        while (it != futures.end())
+        ret.reserve(futures.size());
+        for (auto &&f : futures)
         {
-            it->wait();
-            auto result = it->get();
+            auto result = pool->Wait(f);
             result.MeshData->FrameTime = 0;
             ret.push_back(result);
-            it = futures.erase(it);
         }
         
         return ret;
@@ -143,6 +222,9 @@ namespace VCore
         }
 
         CMeshBuilder builder;
+        builder.SetVertexDeduplication(m_VertexDeduplication);
+        builder.SetChunkSize(m->GetVoxels().chunkSize());
+        builder.SetThreadPool(GetThreadPool());
         ret = builder.Merge(ret, meshes);
         ret->Name = m->Name;
         ret->FrameTime = 0;
@@ -150,7 +232,7 @@ namespace VCore
         return ret;
     }
 
-    std::vector<Mesh> IMesher::GenerateScene(SceneNode sceneTree, Math::Mat4x4 modelMatrix, bool mergeChilds)
+    std::vector<Mesh> IMesher::GenerateScene(SceneNode sceneTree, Math::Mat4x4 modelMatrix, bool mergeChilds, const std::vector<Mesh> &_Meshes, size_t &_Next)
     {
         std::vector<Mesh> ret;
 
@@ -161,7 +243,7 @@ namespace VCore
 
         if(sceneTree->Mesh)
         {
-            auto mesh = GenerateMesh(sceneTree->Mesh);
+            auto mesh = _Meshes[_Next++];
             if(mesh)
             {
                 mesh->ModelMatrix = modelMatrix;
@@ -170,9 +252,10 @@ namespace VCore
         }
         else if(sceneTree->Animation)
         {
-            auto meshes = GenerateAnimation(sceneTree->Animation);
-            for (auto &&m : meshes)
+            for (size_t i = 0; i < sceneTree->Animation->GetFrameCount(); i++)
             {
+                auto m = _Meshes[_Next++];
+                m->FrameTime = sceneTree->Animation->GetFrame(i).FrameTime;
                 m->ModelMatrix = modelMatrix;
                 ret.push_back(m);
             }
@@ -180,13 +263,15 @@ namespace VCore
 
         for (auto &&node : *sceneTree)
         {
-            auto res = GenerateScene(node, modelMatrix, mergeChilds);
+            auto res = GenerateScene(node, modelMatrix, mergeChilds, _Meshes, _Next);
 
             if(!mergeChilds /*|| !sceneTree->Mesh*/)
                 ret.insert(ret.end(), res.begin(), res.end());
             else
             {
                 CMeshBuilder builder;
+                builder.SetVertexDeduplication(m_VertexDeduplication);
+                builder.SetThreadPool(GetThreadPool());
 
                 std::vector<Mesh> meshes;
                 for (auto &&m : res)
@@ -216,6 +301,281 @@ namespace VCore
         }
     }
 
+    void IMesher::SetSmoothShading(bool _Enable, int _Iterations)
+    {
+        m_SmoothShading = _Enable;
+        m_SmoothingIterations = std::max(_Iterations, 0);
+    }
+
+    void IMesher::SetAmbientOcclusion(bool _Enable)
+    {
+        m_AmbientOcclusion = _Enable;
+    }
+
+    void IMesher::SetVertexDeduplication(bool _Enable)
+    {
+        m_VertexDeduplication = _Enable;
+    }
+
+    void IMesher::SetThreadPool(std::shared_ptr<CThreadPool> _Pool)
+    {
+        std::lock_guard<std::mutex> lock(m_ThreadPoolLock);
+        m_ThreadPool = _Pool;
+    }
+
+    std::shared_ptr<CThreadPool> IMesher::GetThreadPool()
+    {
+        std::lock_guard<std::mutex> lock(m_ThreadPoolLock);
+        if(!m_ThreadPool)
+            m_ThreadPool = std::make_shared<CThreadPool>();
+
+        return m_ThreadPool;
+    }
+
+    std::vector<VoxelModel> IMesher::GetLodModels(VoxelModel _Mesh)
+    {
+        const size_t revision = _Mesh->GetVoxels().revision();
+        std::vector<VoxelModel> models = {_Mesh};
+        {
+            std::lock_guard<std::mutex> lock(m_LodModelsLock);
+            auto it = m_LodModels.find(_Mesh.get());
+            if(it != m_LodModels.end() && it->second.Model.lock() == _Mesh && it->second.Revision == revision)
+                models.insert(models.end(), it->second.Levels.begin(), it->second.Levels.end());
+        }
+
+        // Each level is downsampled from the previous one, so one chunk of a level covers 2x2x2 chunks of the finer level.
+        if(models.size() > m_LodDistances.size())
+            return models;
+
+        while (models.size() <= m_LodDistances.size())
+            models.push_back(models.back()->Downsample(2));
+
+        std::lock_guard<std::mutex> lock(m_LodModelsLock);
+        for (auto it = m_LodModels.begin(); it != m_LodModels.end();)
+        {
+            if(it->second.Model.expired())
+                it = m_LodModels.erase(it);
+            else
+                ++it;
+        }
+
+        m_LodModels[_Mesh.get()] = {_Mesh, revision, std::vector<VoxelModel>(models.begin() + 1, models.end())};
+        return models;
+    }
+
+    Texture IMesher::GetPalette(VoxelModel _Model)
+    {
+        auto it = _Model->Textures.find(TextureType::DIFFIUSE);
+        if(it == _Model->Textures.end())
+            return nullptr;
+
+        return it->second;
+    }
+
+    Math::Vec2f IMesher::GetColorUV(const Texture &_Palette, int _Color)
+    {
+        if(_Palette)
+            return Math::Vec2f(((float)(_Color + 0.5f)) / _Palette->GetSize().x, 0.5f);
+
+#ifdef VERTEX_COMPACT
+        return Math::Vec2f(_Color / 65535.f, 0);
+#else
+        return Math::Vec2f(_Color, 0);
+#endif
+    }
+
+    std::vector<SMeshChunk> IMesher::GenerateLodChunks(VoxelModel _Mesh, bool _OnlyDirty)
+    {
+        std::vector<VoxelModel> models = GetLodModels(_Mesh);
+        std::vector<ankerl::unordered_dense::map<Math::Vec3i, SChunkMeta, Math::Vec3iHasher>> levels(m_LodDistances.size() + 1);
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            for (auto &&c : models[i]->QueryChunks())
+                levels[i].insert({c.TotalBBox.Beg, c});
+        }
+
+        // Chunks of every level, which cover a dirty chunk or lie within the halo of such a chunk.
+        std::vector<ankerl::unordered_dense::set<Math::Vec3i, Math::Vec3iHasher>> dirty(levels.size());
+        if(_OnlyDirty)
+        {
+            const Math::Vec3i chunkSize = _Mesh->GetVoxels().chunkSize();
+            const int halo = GetHaloRadius();
+            Math::Vec3i rings;
+            for (int i = 0; i < 3; i++)
+                rings.v[i] = (halo + chunkSize.v[i] - 1) / chunkSize.v[i];
+
+            auto floorDiv = [](int _Value, int _Divisor) { return (_Value >= 0) ? _Value / _Divisor : -((-_Value + _Divisor - 1) / _Divisor); };
+            for (auto &&c : _Mesh->QueryDirtyChunks())
+            {
+                for (size_t i = 0; i < levels.size(); i++)
+                {
+                    Math::Vec3i pos;
+                    for (int j = 0; j < 3; j++)
+                        pos.v[j] = floorDiv(c.TotalBBox.Beg.v[j], chunkSize.v[j] << i) * chunkSize.v[j];
+
+                    for (int x = -rings.x; x <= rings.x; x++)
+                    {
+                        for (int y = -rings.y; y <= rings.y; y++)
+                        {
+                            for (int z = -rings.z; z <= rings.z; z++)
+                                dirty[i].insert(pos + Math::Vec3i(x, y, z) * chunkSize);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Walks from the coarsest level down, until a chunk is far enough away for its level.
+        std::vector<std::pair<int, SChunkMeta>> selected;
+        std::function<void(int, const SChunkMeta&)> select = [&](int _Level, const SChunkMeta &_Chunk)
+        {
+            int scale = 1 << _Level;
+            CBBox bbox(_Chunk.TotalBBox.Beg * scale, _Chunk.TotalBBox.End * scale);
+            if(m_Frustum && !m_Frustum->IsOnFrustum(bbox))
+                return;
+
+            Math::Vec3f closest = m_LodViewer.max(Math::Vec3f(bbox.Beg)).min(Math::Vec3f(bbox.End));
+            if(_Level == 0 || (closest - m_LodViewer).length() >= m_LodDistances[_Level - 1])
+            {
+                if(!_OnlyDirty || dirty[_Level].find(_Chunk.TotalBBox.Beg) != dirty[_Level].end())
+                    selected.push_back({_Level, _Chunk});
+
+                return;
+            }
+
+            Math::Vec3i size = _Chunk.TotalBBox.End - _Chunk.TotalBBox.Beg;
+            for (int i = 0; i < 8; i++)
+            {
+                Math::Vec3i child = _Chunk.TotalBBox.Beg * 2 + Math::Vec3i(i & 1, (i >> 1) & 1, (i >> 2) & 1) * size;
+                auto it = levels[_Level - 1].find(child);
+                if(it != levels[_Level - 1].end())
+                    select(_Level - 1, it->second);
+            }
+        };
+
+        for (auto &&c : levels.back())
+            select(levels.size() - 1, c.second);
+
+        for (auto &&c : levels.front())
+            _Mesh->GetVoxels().markAsProcessed(c.second);
+
+        auto pool = GetThreadPool();
+        std::vector<std::future<SMeshChunk>> futures;
+        for (auto &&c : selected)
+            futures.push_back(pool->Enqueue(&IMesher::GenerateMeshChunk, this, models[c.first], c.second, true));
+
+        std::vector<SMeshChunk> ret;
+        ret.reserve(futures.size());
+        for (size_t i = 0; i < futures.size(); i++)
+        {
+            auto result = pool->Wait(futures[i]);
+            int level = selected[i].first;
+            int scale = 1 << level;
+
+            // Moves the chunk back into the voxel space of the model.
+            if(level > 0)
+            {
+                result.UniqueId = SChunkMeta::MakeUniqueId(result.TotalBBox.Beg, models[level]->GetVoxels().chunkSize(), level);
+                result.TotalBBox = CBBox(result.TotalBBox.Beg * scale, result.TotalBBox.End * scale);
+                result.InnerBBox = CBBox(result.InnerBBox.Beg * scale, (result.InnerBBox.End + Math::Vec3i(1, 1, 1)) * scale - Math::Vec3i(1, 1, 1));
+                result.MeshData = ScaleMesh(result.MeshData, scale);
+            }
+
+            result.Lod = level;
+            if(result.MeshData)
+                result.MeshData->FrameTime = 0;
+
+            ret.push_back(result);
+        }
+
+        return ret;
+    }
+
+    SMeshChunkDelta IMesher::UpdateChunks(VoxelModel _Mesh)
+    {
+        SMeshChunkDelta ret;
+        if(m_CachedModel.lock() != _Mesh)
+            ClearChunkCache();
+
+        // A new model is meshed completely, afterwards only the chunks which changed since the last update.
+        bool full = m_ChunkCache.empty();
+        m_CachedModel = _Mesh;
+
+        CVoxelSpace::querylist chunks;
+        if(full)
+            chunks = _Mesh->QueryChunks();
+        else
+        {
+            _Mesh->GetVoxels().expandDirtyChunks(GetHaloRadius());
+            chunks = _Mesh->QueryDirtyChunks();
+        }
+
+        auto pool = GetThreadPool();
+        std::vector<std::future<SMeshChunk>> futures;
+        for (auto &&c : chunks)
+        {
+            _Mesh->GetVoxels().markAsProcessed(c);
+            futures.push_back(pool->Enqueue(&IMesher::GenerateMeshChunk, this, _Mesh, c, true));
+        }
+
+        for (auto &&f : futures)
+        {
+            auto result = pool->Wait(f);
+            if(result.MeshData)
+                result.MeshData->FrameTime = 0;
+
+            auto it = m_ChunkCache.find(result.TotalBBox.Beg);
+            if(it == m_ChunkCache.end())
+            {
+                m_ChunkCache.insert({result.TotalBBox.Beg, result});
+                ret.Added.push_back(result);
+            }
+            else
+            {
+                it->second = result;
+                ret.Updated.push_back(result);
+            }
+        }
+
+        // Chunks are removed as soon as they are empty, so each cached chunk must still exist.
+        if(!full)
+        {
+            ankerl::unordered_dense::set<Math::Vec3i, Math::Vec3iHasher> existing;
+            for (auto &&c : _Mesh->QueryChunks())
+                existing.insert(c.TotalBBox.Beg);
+
+            std::vector<Math::Vec3i> removed;
+            for (auto &&c : m_ChunkCache)
+            {
+                if(existing.find(c.first) == existing.end())
+                {
+                    removed.push_back(c.first);
+                    ret.Removed.push_back(c.second.UniqueId);
+                }
+            }
+
+            for (auto &&pos : removed)
+                m_ChunkCache.erase(pos);
+        }
+
+        return ret;
+    }
+
+    void IMesher::ClearChunkCache()
+    {
+        m_ChunkCache.clear();
+        m_CachedModel.reset();
+
+        std::lock_guard<std::mutex> lock(m_LodModelsLock);
+        m_LodModels.clear();
+    }
+
+    void IMesher::SetLod(const Math::Vec3f &_Viewer, const std::vector<float> &_Distances)
+    {
+        m_LodViewer = _Viewer;
+        m_LodDistances = _Distances;
+    }
+
     IMesher::~IMesher()
     {
         if(m_Frustum)
@@ -231,6 +591,8 @@ namespace VCore
             case MesherTypes::MARCHING_CUBES: return std::make_shared<CMarchingCubesMesher>();
             case MesherTypes::GREEDY_CHUNKED: return std::make_shared<CGreedyChunkedMesher>();
             case MesherTypes::GREEDY_TEXTURED: return std::make_shared<CGreedyMesher>(true);
+            case MesherTypes::GREEDY_MASK: return std::make_shared<CMaskGreedyMesher>();
+            case MesherTypes::SURFACE_NETS: return std::make_shared<CSurfaceNetsMesher>();
             default:
                 throw std::runtime_error("Invalid mesher type!");
         }
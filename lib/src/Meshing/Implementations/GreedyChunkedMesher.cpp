@@ -36,6 +36,7 @@ namespace VCore
     SMeshChunk CGreedyChunkedMesher::GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool)
     {
         CMeshBuilder builder;
+        builder.SetVertexDeduplication(m_VertexDeduplication);
         builder.AddTextures(m->Textures);
 
         CBBox BBox = _Chunk.InnerBBox;
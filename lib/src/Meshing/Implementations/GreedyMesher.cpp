@@ -22,10 +22,12 @@
  * SOFTWARE.
  */
 
-#include <chrono>
-#include <future>
-
-#include "Slicer/Slicer.hpp"
+#include "PaddedBlock.hpp"
+#include "Slicer/FaceMask.hpp"
+#include "../../Misc/TexturePacker.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <VCore/Meshing/MeshBuilder.hpp>
 #include <vector>
 
@@ -33,12 +35,12 @@
 
 namespace VCore
 {
-    template<typename R>
-    bool is_ready(std::future<R> const& f)
-    { return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
-
     std::vector<SMeshChunk> CGreedyMesher::GenerateChunks(VoxelModel _Mesh, bool _OnlyDirty)
     {
+        // Chunks of different levels can't be merged, so each one is meshed on its own.
+        if(HasLod())
+            return GenerateLodChunks(_Mesh, _OnlyDirty);
+
        std::vector<SMeshChunk> ret;
 
         CVoxelSpace::querylist chunks;
@@ -49,276 +51,307 @@ namespace VCore
             if(!_OnlyDirty)
                 chunks = _Mesh->QueryChunks();
             else
+            {
+                _Mesh->GetVoxels().expandDirtyChunks(GetHaloRadius());
                 chunks = _Mesh->QueryDirtyChunks();
+            }
         }
 
-        CSliceCollection collection;
-
-        std::vector<std::future<CSliceCollection>> futures;
+        // Groups the chunks into layers along each axis. Every slice belongs to exactly one layer, so all layers can be meshed independently.
+        // A layer spans at most MAX_LAYER_EXTENT voxels on the other two axes, so the memory of a layer doesn't grow with the size of the model.
+        auto floorDiv = [](int _Value, int _Divisor) { return (_Value >= 0) ? _Value / _Divisor : -((-_Value + _Divisor - 1) / _Divisor); };
+        VectoriMap<std::vector<SChunkMeta>> layers[3];
         for (auto &&c : chunks)
         {
             _Mesh->GetVoxels().markAsProcessed(c);
-            futures.push_back(std::async(&CGreedyMesher::GenerateSlicedChunk, this, _Mesh, c, true));
-            while(futures.size() >= std::thread::hardware_concurrency())
+            for (int axis = 0; axis < 3; axis++)
             {
-                auto it = futures.begin();
-                while (it != futures.end())
-                {
-                    if(is_ready(*it))
-                    {
-                        auto result = it->get();
-                        collection.Merge(result);                     
-                        it = futures.erase(it);
-                    }
-                    else
-                        it++;
-                }
+                Math::Vec3i key = c.TotalBBox.Beg;
+                key.v[(axis + 1) % 3] = floorDiv(key.v[(axis + 1) % 3], MAX_LAYER_EXTENT);
+                key.v[(axis + 2) % 3] = floorDiv(key.v[(axis + 2) % 3], MAX_LAYER_EXTENT);
+                layers[axis][key].push_back(c);
             }
         }
 
-        auto it = futures.begin();
-        while (it != futures.end())
+        auto pool = GetThreadPool();
+        std::vector<std::future<SQuadLayer>> futures;
+        for (int axis = 0; axis < 3; axis++)
         {
-            it->wait();
-            auto result = it->get();
-            collection.Merge(result);       
-            it = futures.erase(it);
+            for (auto &&layer : layers[axis])
+                futures.push_back(pool->Enqueue(&CGreedyMesher::GenerateLayer, this, _Mesh, axis, std::move(layer.second)));
         }
 
+        std::vector<SQuadLayer> results;
+        results.reserve(futures.size());
+        for (auto &&f : futures)
+            results.push_back(pool->Wait(f));
+
+        // We only have always one chunk using this technique.
+        SMeshChunk chunk;
+        Math::Vec3iHasher hasher;
+        auto bbox = _Mesh->GetBBox();
+
+        chunk.UniqueId = hasher(bbox.Beg);
+        chunk.InnerBBox = bbox;
+        chunk.TotalBBox = bbox;
+        chunk.MeshData = BuildMesh(_Mesh, results);
+
+        ret.push_back(chunk);
+        
+        return ret;
+    }
+
+    SMeshChunk CGreedyMesher::GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool)
+    {
+        std::vector<SQuadLayer> layers;
+        for (int axis = 0; axis < 3; axis++)
+            layers.push_back(GenerateLayer(m, axis, {_Chunk}));
+
+        SMeshChunk chunk;
+        chunk.UniqueId = _Chunk.UniqueId;
+        chunk.InnerBBox = _Chunk.InnerBBox;
+        chunk.TotalBBox = _Chunk.TotalBBox;
+        chunk.MeshData = BuildMesh(m, layers);
+
+        return chunk;
+    }
+
+    Mesh CGreedyMesher::BuildMesh(VoxelModel m, std::vector<SQuadLayer> &_Layers)
+    {
         CMeshBuilder builder;
-        auto textures = _Mesh->Textures;
-        auto &materials = _Mesh->Materials;
+        builder.SetVertexDeduplication(m_VertexDeduplication);
+        auto textures = m->Textures;
+        auto &materials = m->Materials;
 
-        collection.Optimize(m_GenerateTexture);
         if(m_GenerateTexture)
-            textures = collection.Textures;
+            textures = PackTextures(_Layers);
 
         builder.AddTextures(textures);
 
+        // The quads of each material are already known, so the builder allocates its buffers only once. The last entry counts the quads without a material.
+        std::vector<size_t> faces(materials.size() + 1, 0);
+        for (auto &&layer : _Layers)
+        {
+            for (auto &&quad : layer.Faces)
+                faces[std::min<size_t>(quad.Material, materials.size())]++;
+        }
+
+        for (size_t i = 0; i < faces.size(); i++)
+        {
+            if(faces[i])
+                builder.Reserve(i < materials.size() ? materials[i] : Material(), faces[i] * 4, faces[i] * 6);
+        }
+
         // Generate the mesh.
-        for (size_t runAxis = 0; runAxis < 3; runAxis++)
+        for (auto &&layer : _Layers)
         {
-            auto &slices = collection.mSlices[runAxis];
-            for (auto &&slice : slices) // std::map<int, Slice>;
+            int runAxis = layer.Axis;
+            for (auto &&quad : layer.Faces)
             {
-                for (auto &&height : slice.second) // std::map<int, Quads>;
-                {
-                    for (auto &&quad : height.second)
-                    {
-                        int heightAxis = (runAxis + 1) % 3; // 1 = 1 = y, 2 = 2 = z, 3 = 0 = x
-                        int widthAxis = (runAxis + 2) % 3; // 2 = 2 = z, 3 = 0 = x, 4 = 1 = y
+                int heightAxis = (runAxis + 1) % 3; // 1 = 1 = y, 2 = 2 = z, 3 = 0 = x
+                int widthAxis = (runAxis + 2) % 3; // 2 = 2 = z, 3 = 0 = x, 4 = 1 = y
 
-                        Math::Vec3f du;
-                        du.v[widthAxis] = quad.mQuad.second.v[widthAxis];
+                Math::Vec3f du;
+                du.v[widthAxis] = quad.mQuad.second.v[widthAxis];
 
-                        Math::Vec3f dv;
-                        dv.v[heightAxis] = quad.mQuad.second.v[heightAxis];
+                Math::Vec3f dv;
+                dv.v[heightAxis] = quad.mQuad.second.v[heightAxis];
 
-                        Math::Vec3f v1 = quad.mQuad.first;
-                        Math::Vec3f v2 = quad.mQuad.first + du;
-                        Math::Vec3f v3 = quad.mQuad.first + dv;
-                        Math::Vec3f v4 = quad.mQuad.first + quad.mQuad.second;
+                Math::Vec3f v1 = quad.mQuad.first;
+                Math::Vec3f v2 = quad.mQuad.first + du;
+                Math::Vec3f v3 = quad.mQuad.first + dv;
+                Math::Vec3f v4 = quad.mQuad.first + quad.mQuad.second;
 
-                        Material mat;
-                        if(quad.Material < (int)materials.size())
-                            mat = materials[quad.Material];
+                Material mat;
+                if(quad.Material < (int)materials.size())
+                    mat = materials[quad.Material];
 
-                        if(m_GenerateTexture)
-                        {
-                            Math::Vec3f faceNormal = (v2 - v1).cross(v3 - v1).normalize();
-
-                            if(faceNormal == quad.Normal)
-                            {
-                                builder.AddFace(
-                                    SVertex(v1, quad.Normal, Math::Vec2f(quad.UvStart) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    SVertex(v2, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(du.v[widthAxis], 0)) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    SVertex(v3, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(0, -dv.v[heightAxis])) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    mat);
-
-                                builder.AddFace(
-                                    SVertex(v2, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(du.v[widthAxis], 0)) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    SVertex(v4, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(du.v[widthAxis], -dv.v[heightAxis])) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    SVertex(v3, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(0, -dv.v[heightAxis])) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    mat);
-                            } 
-                            else
-                            {
-                                builder.AddFace(
-                                    SVertex(v3, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(0, -dv.v[heightAxis])) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    SVertex(v2, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(du.v[widthAxis], 0)) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    SVertex(v1, quad.Normal, Math::Vec2f(quad.UvStart) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    mat);
-
-                                builder.AddFace(
-                                    SVertex(v3, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(0, -dv.v[heightAxis])) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    SVertex(v4, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(du.v[widthAxis], -dv.v[heightAxis])) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    SVertex(v2, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(du.v[widthAxis], 0)) / Math::Vec2f(collection.Textures[TextureType::DIFFIUSE]->GetSize())),
-                                    mat);
-                            }
-                        }
-                        else
-                            builder.AddFace(v1, v2, v3, v4, quad.Normal, quad.Color, mat);
-                    }
+                uint8_t occlusion[4];
+                UnpackFaceOcclusion(quad.Occlusion, occlusion);
+                const uint8_t *quadOcclusion = m_AmbientOcclusion ? occlusion : nullptr;
+
+                if(m_GenerateTexture)
+                {
+                    Math::Vec2f textureSize(textures[TextureType::DIFFIUSE]->GetSize());
+                    builder.AddFace(
+                        SVertex(v1, quad.Normal, Math::Vec2f(quad.UvStart) / textureSize),
+                        SVertex(v2, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(du.v[widthAxis], 0)) / textureSize),
+                        SVertex(v3, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(0, -dv.v[heightAxis])) / textureSize),
+                        SVertex(v4, quad.Normal, Math::Vec2f(quad.UvStart + Math::Vec2ui(du.v[widthAxis], -dv.v[heightAxis])) / textureSize),
+                        mat, quadOcclusion);
                 }
+                else
+                    builder.AddFace(v1, v2, v3, v4, quad.Normal, quad.Color, mat, quadOcclusion);
             }
         }
 
-        // We only have always one chunk using this technique.
-        SMeshChunk chunk;
-        Math::Vec3iHasher hasher;
-        auto bbox = _Mesh->GetBBox();
-
-        chunk.UniqueId = hasher(bbox.Beg);
-        chunk.InnerBBox = bbox;
-        chunk.TotalBBox = bbox;
-        chunk.MeshData = builder.Build();
-
-        ret.push_back(chunk);
-        
-        return ret;
+        return builder.Build();
     }
 
-    CSliceCollection CGreedyMesher::GenerateSlicedChunk(VoxelModel m, const SChunkMeta &_Chunk, bool)
+    SQuadLayer CGreedyMesher::GenerateLayer(VoxelModel m, int _Axis, std::vector<SChunkMeta> _Chunks)
     {
-        CBBox BBox = _Chunk.InnerBBox;
-        CSlicer Slicer(m, _Chunk.Chunk, _Chunk.TotalBBox);
-        CSliceCollection result;
-
-        auto albedo = m->Textures[TextureType::DIFFIUSE];
-        Texture emission;
-        auto textureIt = m->Textures.find(TextureType::EMISSION);
-        if(textureIt != m->Textures.end())
-            emission = textureIt->second;
-
-        // For all 3 axis (x, y, z)
-        for (size_t Axis = 0; Axis < 3; Axis++)
+        int heightAxis = (_Axis + 1) % 3; // 1 = 1 = y, 2 = 2 = z, 3 = 0 = x
+        int widthAxis = (_Axis + 2) % 3; // 2 = 2 = z, 3 = 0 = x, 4 = 1 = y
+
+        Math::Vec3i beg = _Chunks.front().InnerBBox.Beg;
+        Math::Vec3i end = _Chunks.front().InnerBBox.End;
+        for (auto &&c : _Chunks)
+        {
+            beg = beg.min(c.InnerBBox.Beg);
+            end = end.max(c.InnerBBox.End);
+        }
+
+        // Copies the voxels of the whole layer into one flat array, so that faces can be merged across the chunk borders.
+        const Math::Vec3i size = end - beg + Math::Vec3i(1, 1, 1);
+        std::vector<uint64_t> cells(size.x * size.y * size.z, 0);
+        for (auto &&c : _Chunks)
+        {
+            c.Chunk->forEachVisible(CBBox(c.TotalBBox.Beg, c.TotalBBox.GetSize()), [&](const Math::Vec3i &_Position, Voxel _Voxel)
+            {
+                Math::Vec3i p = _Position - beg;
+                cells[p.x + size.x * p.y + size.x * size.y * p.z] = PackFaceCell(_Voxel);
+            });
+        }
+
+        // The occlusion of a face reaches one voxel into the neighbouring layers.
+        std::unique_ptr<SPaddedBlock> block;
+        if(m_AmbientOcclusion)
         {
-            Slicer.SetActiveAxis(Axis);
+            auto accessor = m->GetVoxels().createAccessor();
+            block = std::make_unique<SPaddedBlock>(accessor, beg - Math::Vec3i(1, 1, 1), size + Math::Vec3i(2, 2, 2));
+        }
+
+        // Textured quads are only split by material, the colors are baked into the texture.
+        const uint64_t key = m_GenerateTexture ? FACE_CELL_MATERIAL : FACE_CELL_KEY;
+
+        const size_t strides[3] = { 1, (size_t)size.x, (size_t)(size.x * size.y) };
+        const int width = size.v[widthAxis];
+        const int height = size.v[heightAxis];
 
-            int Axis1 = (Axis + 1) % 3; // 1 = 1 = y, 2 = 2 = z, 3 = 0 = x
-            int Axis2 = (Axis + 2) % 3; // 2 = 2 = z, 3 = 0 = x, 4 = 1 = y
-            int x[3] = {};
+        // Face bits of CVoxel::Visibility for the positive and negative direction of each axis.
+        const uint8_t positiveFaces[3] = { CVoxel::Visibility::RIGHT, CVoxel::Visibility::UP, CVoxel::Visibility::FORWARD };
+        const uint8_t negativeFaces[3] = { CVoxel::Visibility::LEFT, CVoxel::Visibility::DOWN, CVoxel::Visibility::BACKWARD };
 
-            // Iterate over each slice of the 3d model.
-            for (x[Axis] = BBox.Beg.v[Axis] -1; x[Axis] <= BBox.End.v[Axis];)
+        SQuadLayer result;
+        result.Axis = _Axis;
+        std::vector<uint64_t> mask(width * height);
+
+        // The palettes, whose colors are baked into the pixel arena of the layer.
+        std::vector<std::pair<const std::vector<uint32_t>*, std::vector<uint32_t>*>> palettes;
+        if(m_GenerateTexture)
+        {
+            for (auto &&texture : m->Textures)
+                palettes.push_back({&texture.second->GetPixels(), &result.Pixels[texture.first]});
+        }
+
+        for (int slice = 0; slice < size.v[_Axis]; slice++)
+        {
+            for (int positive = 0; positive < 2; positive++)
             {
-                ++x[Axis];
-                result.AddSlice(Axis, x[Axis]);
+                const uint8_t face = positive ? positiveFaces[_Axis] : negativeFaces[_Axis];
+                const size_t sliceIdx = slice * strides[_Axis];
 
-                // Foreach slice go over a 2d plane. 
-                for (int HeightAxis = BBox.Beg.v[Axis1]; HeightAxis <= BBox.End.v[Axis1]; ++HeightAxis)
+                bool empty = true;
+                for (int h = 0; h < height; h++)
                 {
-                    for (int WidthAxis = BBox.Beg.v[Axis2]; WidthAxis <= BBox.End.v[Axis2];)
+                    size_t idx = sliceIdx + h * strides[heightAxis];
+                    for (int w = 0; w < width; w++, idx += strides[widthAxis])
                     {
-                        Math::Vec3i Pos;
-                        Pos.v[Axis] = x[Axis] - 1;
-                        Pos.v[Axis1] = HeightAxis;
-                        Pos.v[Axis2] = WidthAxis;
-
-                        std::map<TextureType, std::vector<CColor>> rawTextures;
-
-                        if(Slicer.IsFace(Pos))
+                        mask[w + width * h] = FaceMaskKey(cells[idx], face, key);
+                        if(mask[w + width * h] && block)
                         {
-                            int w, h;
-                            Math::Vec3i Normal = Slicer.Normal();
-                            int material = Slicer.Material();
-                            int Color = Slicer.Color();
-
-                            if(m_GenerateTexture)
-                            {
-                                rawTextures[TextureType::DIFFIUSE].push_back(albedo->GetPixel(Math::Vec2ui(Slicer.Color(), 0)));
-                                if(emission)
-                                    rawTextures[TextureType::EMISSION].push_back(emission->GetPixel(Math::Vec2ui(Slicer.Color(), 0)));
-                            }
-
-                            //Claculates the width of the rect.
-                            for (w = 1; WidthAxis + w <= BBox.End.v[Axis2]; w++) 
-                            {
-                                Math::Vec3i WPos;
-                                WPos.v[Axis2] = w;
-
-                                bool IsFace = Slicer.IsFace(Pos + WPos);
-                                if(IsFace)
-                                {
-                                    Math::Vec3i FaceNormal = Slicer.Normal();
-                                    IsFace = Normal == FaceNormal && material == Slicer.Material() && (m_GenerateTexture || Color == Slicer.Color());
-                                }
-
-                                if(!IsFace)
-                                    break;
-                                else if(m_GenerateTexture)
-                                {
-                                    rawTextures[TextureType::DIFFIUSE].push_back(albedo->GetPixel(Math::Vec2ui(Slicer.Color(), 0)));
-                                    if(emission)
-                                        rawTextures[TextureType::EMISSION].push_back(emission->GetPixel(Math::Vec2ui(Slicer.Color(), 0)));
-                                }
-                            }
-
-                            bool done = false;
-                            for (h = 1; HeightAxis + h <= BBox.End.v[Axis1]; h++)
-                            {
-                                // Check each block next to this quad
-                                for (int k = 0; k < w; ++k)
-                                {
-                                    Math::Vec3i QuadPos = Pos;
-                                    QuadPos.v[Axis2] += k;
-                                    QuadPos.v[Axis1] += h;
-
-                                    bool IsFace = Slicer.IsFace(QuadPos);
-                                    if(IsFace)
-                                    {
-                                        Math::Vec3i FaceNormal = Slicer.Normal();
-                                        IsFace = Normal == FaceNormal && material == Slicer.Material() && (m_GenerateTexture || Color == Slicer.Color());
-                                    }
-
-                                    // If there's a hole in the mask, exit
-                                    if (!IsFace)
-                                    {
-                                        done = true;
-                                        break;
-                                    }
-                                    else if(m_GenerateTexture)
-                                    {
-                                        rawTextures[TextureType::DIFFIUSE].push_back(albedo->GetPixel(Math::Vec2ui(Slicer.Color(), 0)));
-                                        if(emission)
-                                            rawTextures[TextureType::EMISSION].push_back(emission->GetPixel(Math::Vec2ui(Slicer.Color(), 0)));
-                                    }
-                                }
-
-                                if (done)
-                                    break;
-                            }
-
-                            x[Axis1] = HeightAxis;
-                            x[Axis2] = WidthAxis;
-
-                            int du[3] = {};
-                            du[Axis2] = w;
-
-                            int dv[3] = {};
-                            dv[Axis1] = h;
-                    
-                            Slicer.AddProcessedQuad(Math::Vec3i(x[0], x[1], x[2]), Math::Vec3i(du[0] + dv[0], du[1] + dv[1], du[2] + dv[2]));
-                            
-                            if(m_GenerateTexture)
-                                result.AddQuadInfo(Axis, x[Axis], x[Axis1], CQuadInfo({Math::Vec3i(x[0], x[1], x[2]), Math::Vec3i(du[0] + dv[0], du[1] + dv[1], du[2] + dv[2])}, Normal, material, rawTextures));
-                            else
-                                result.AddQuadInfo(Axis, x[Axis], x[Axis1], CQuadInfo({Math::Vec3i(x[0], x[1], x[2]), Math::Vec3i(du[0] + dv[0], du[1] + dv[1], du[2] + dv[2])}, Normal, material, Color));
-
-                            // Increment counters and continue
-                            WidthAxis += w;
+                            Math::Vec3i layer;
+                            layer.v[_Axis] = slice + (positive ? 1 : -1);
+                            layer.v[heightAxis] = h;
+                            layer.v[widthAxis] = w;
+                            mask[w + width * h] = FaceMaskOcclusion(mask[w + width * h], block->FaceOcclusion(block->Index(beg + layer), _Axis, widthAxis, heightAxis));
                         }
-                        else
-                            WidthAxis++;
+
+                        empty &= !mask[w + width * h];
                     }
                 }
 
-                Slicer.ClearQuads();
-            }
+                if(empty)
+                    continue;
+
+                Math::Vec3i normal;
+                normal.v[_Axis] = positive ? 1 : -1;
 
-            // break;
+                MergeFaceMask(mask, width, height, [&](int w, int h, int quadWidth, int quadHeight, uint64_t _Key)
+                {
+                    Math::Vec3i pos, quadSize;
+                    pos.v[_Axis] = beg.v[_Axis] + slice + positive;
+                    pos.v[heightAxis] = beg.v[heightAxis] + h;
+                    pos.v[widthAxis] = beg.v[widthAxis] + w;
+                    quadSize.v[heightAxis] = quadHeight;
+                    quadSize.v[widthAxis] = quadWidth;
+
+                    uint64_t cell = cells[sliceIdx + h * strides[heightAxis] + w * strides[widthAxis]];
+                    result.Faces.emplace_back(Quad(pos, quadSize), normal, FaceCellMaterial(cell), m_GenerateTexture ? 0 : FaceCellColor(cell));
+                    result.Faces.back().Occlusion = FaceCellOcclusion(_Key);
+                    if(!m_GenerateTexture)
+                        return;
+
+                    // Appends the colors of the quad row by row to the arena.
+                    result.Faces.back().PixelOffset = palettes.empty() ? 0 : palettes.front().second->size();
+                    for (auto &&palette : palettes)
+                    {
+                        const std::vector<uint32_t> &colors = *palette.first;
+                        std::vector<uint32_t> &pixels = *palette.second;
+                        for (int y = 0; y < quadHeight; y++)
+                        {
+                            size_t idx = sliceIdx + (h + y) * strides[heightAxis] + w * strides[widthAxis];
+                            for (int x = 0; x < quadWidth; x++, idx += strides[widthAxis])
+                                pixels.push_back(colors[FaceCellColor(cells[idx])]);
+                        }
+                    }
+                });
+            }
         }
 
         return result;
     }
+
+    std::map<TextureType, Texture> CGreedyMesher::PackTextures(std::vector<SQuadLayer> &_Layers)
+    {
+        // Each rect references its quad and the layer, which holds the pixels of the quad.
+        std::vector<std::pair<CQuadInfo*, const SQuadLayer*>> references;
+        for (auto &&layer : _Layers)
+        {
+            for (auto &&quad : layer.Faces)
+                references.push_back({&quad, &layer});
+        }
+
+        CTexturePacker packer;
+        for (auto &&reference : references)
+        {
+            int heightAxis = (reference.second->Axis + 1) % 3;
+            int widthAxis = (reference.second->Axis + 2) % 3;
+            packer.AddRect(Math::Vec2ui(reference.first->mQuad.second.v[widthAxis], reference.first->mQuad.second.v[heightAxis]), &reference);
+        }
+
+        // Packs the rects to fit into one texture.
+        auto &rects = packer.Pack();
+
+        // Creates the texture object, which can fit all quads.
+        std::map<TextureType, Texture> textures;
+        textures[TextureType::DIFFIUSE] = std::make_shared<CTexture>(packer.GetCanvasSize());
+        for (auto &&rect : rects)
+        {
+            auto reference = (std::pair<CQuadInfo*, const SQuadLayer*>*)rect.Reference;
+            auto quad = reference->first;
+            quad->UvStart = Math::Vec2ui(rect.Position.x, textures[TextureType::DIFFIUSE]->GetSize().y - rect.Position.y);
+
+            for (auto &&pixels : reference->second->Pixels)
+            {
+                auto &texture = textures[pixels.first];
+                if(!texture)
+                    texture = std::make_shared<CTexture>(packer.GetCanvasSize());
+
+                texture->AddRawPixels(pixels.second.data() + quad->PixelOffset, rect.Position, rect.Size);
+            }
+        }
+
+        return textures;
+    }
 }
@@ -25,6 +25,8 @@
 #ifndef GREEDYMESHER_HPP
 #define GREEDYMESHER_HPP
 
+#include <map>
+#include <utility>
 #include <vector>
 #include <VCore/Meshing/IMesher.hpp>
 #include "Slicer/Slices.hpp"
@@ -38,11 +40,41 @@ namespace VCore
 
             std::vector<SMeshChunk> GenerateChunks(VoxelModel _Mesh, bool _OnlyDirty = false) override;
 
+            /**
+             * @return Returns 1 with ambient occlusion, since the occlusion reads the neighbours of each face.
+             */
+            int GetHaloRadius() const override { return m_AmbientOcclusion ? 1 : 0; }
+
             virtual ~CGreedyMesher() = default;
         protected:
+            /**
+             * @brief Largest extent of a layer on the two axes of its slices. Faces are merged across chunk borders, but not across the borders of layers.
+             */
+            static constexpr int MAX_LAYER_EXTENT = 128;
+
             bool m_GenerateTexture;
-            CSliceCollection GenerateSlicedChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque);
-            // SMeshChunk GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque) override;
+
+            /**
+             * @brief Generates the quads of all slices along _Axis, which are covered by one layer of chunks. The layer is at most MAX_LAYER_EXTENT voxels wide and high.
+             * Faces are merged across the chunk borders of the layer, so the quads of different layers never need to be merged.
+             */
+            SQuadLayer GenerateLayer(VoxelModel m, int _Axis, std::vector<SChunkMeta> _Chunks);
+
+            /**
+             * @brief Copies the pixels of all quads from the arenas of the layers into one texture and sets the uv start of each quad.
+             */
+            std::map<TextureType, Texture> PackTextures(std::vector<SQuadLayer> &_Layers);
+
+
+            /**
+             * @brief Meshes a single chunk, used by ::UpdateChunks. Faces are only merged inside of the chunk.
+             */
+            SMeshChunk GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque) override;
+
+            /**
+             * @brief Generates the mesh of the quads of all layers.
+             */
+            Mesh BuildMesh(VoxelModel m, std::vector<SQuadLayer> &_Layers);
     };
 }
 
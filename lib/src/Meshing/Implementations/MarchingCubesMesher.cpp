@@ -23,6 +23,7 @@
  */
 
 #include "MarchingCubesMesher.hpp"
+#include "PaddedBlock.hpp"
 
 namespace VCore
 {
@@ -303,51 +304,33 @@ namespace VCore
         Math::Vec3f(-0.5, 0.5, 0),
     };
 
-    std::vector<std::pair<Math::Vec3f, Math::Vec3f>> Corners = {
-      {Math::Vec3f(0, 0, 0), Math::Vec3f(1, 0, 0)}, 
-      {Math::Vec3f(1, 0, 0), Math::Vec3f(1, 1, 0)},  
-      {Math::Vec3f(1, 1, 0), Math::Vec3f(0, 1, 0)},  
-      {Math::Vec3f(0, 1, 0), Math::Vec3f(0, 0, 0)}, 
-
-      {Math::Vec3f(0, 0, 1), Math::Vec3f(1, 0, 1)},  
-      {Math::Vec3f(1, 0, 1), Math::Vec3f(1, 1, 1)},  
-      {Math::Vec3f(1, 1, 1), Math::Vec3f(0, 1, 1)},  
-      {Math::Vec3f(0, 1, 1), Math::Vec3f(0, 0, 1)}, 
-
-      {Math::Vec3f(0, 0, 1), Math::Vec3f(0, 0, 0)},  
-      {Math::Vec3f(1, 0, 1), Math::Vec3f(1, 0, 0)},  
-      {Math::Vec3f(1, 1, 1), Math::Vec3f(1, 1, 0)},  
-      {Math::Vec3f(0, 1, 1), Math::Vec3f(0, 1, 0)}
+    const static Math::Vec3i CORNERS[12][2] = {
+      {Math::Vec3i(0, 0, 0), Math::Vec3i(1, 0, 0)}, 
+      {Math::Vec3i(1, 0, 0), Math::Vec3i(1, 1, 0)},  
+      {Math::Vec3i(1, 1, 0), Math::Vec3i(0, 1, 0)},  
+      {Math::Vec3i(0, 1, 0), Math::Vec3i(0, 0, 0)}, 
+
+      {Math::Vec3i(0, 0, 1), Math::Vec3i(1, 0, 1)},  
+      {Math::Vec3i(1, 0, 1), Math::Vec3i(1, 1, 1)},  
+      {Math::Vec3i(1, 1, 1), Math::Vec3i(0, 1, 1)},  
+      {Math::Vec3i(0, 1, 1), Math::Vec3i(0, 0, 1)}, 
+
+      {Math::Vec3i(0, 0, 1), Math::Vec3i(0, 0, 0)},  
+      {Math::Vec3i(1, 0, 1), Math::Vec3i(1, 0, 0)},  
+      {Math::Vec3i(1, 1, 1), Math::Vec3i(1, 1, 0)},  
+      {Math::Vec3i(0, 1, 1), Math::Vec3i(0, 1, 0)}
     };
 
-    uint8_t GetTableIndex(VoxelModel m, Math::Vec3f pos)
+    /**
+     * @brief Triangle of the smooth shaded mesh, the vertices are indices into the welded positions.
+     */
+    struct SSmoothTriangle
     {
-        uint8_t ret = 0;
-        int bitPos = 0;
-
-        std::vector<Math::Vec3f> cube = {
-            Math::Vec3f(0, 0, 0),
-            Math::Vec3f(1, 0, 0),
-            Math::Vec3f(1, 1, 0),
-            Math::Vec3f(0, 1, 0),
-
-            Math::Vec3f(0, 0, 1),
-            Math::Vec3f(1, 0, 1),
-            Math::Vec3f(1, 1, 1),
-            Math::Vec3f(0, 1, 1)
-        };
-
-        for (auto &&c : cube)
-        {
-            auto voxel = m->GetVoxel(pos + c);
-            if(!voxel)
-                ret |= 1 << bitPos;
-
-            bitPos++;
-        }
-        
-        return ret;
-    }
+        int Vertices[3];
+        int Color[3];
+        int Material;
+        bool Emit;      //!< False for triangles of the halo, which are only needed to smooth the vertices of the chunk.
+    };
 
     SMeshChunk CMarchingCubesMesher::GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque)
     {
@@ -356,20 +339,95 @@ namespace VCore
         CMeshBuilder builder;
         builder.AddTextures(m->Textures);
 
-        for(int x = _Chunk.InnerBBox.Beg.x - 1; x <= _Chunk.InnerBBox.End.x + 1; x++)
+        // Each call has its own accessor, since this method runs on multiple threads.
+        auto accessor = m->GetVoxels().createAccessor();
+
+        // Every smoothing pass and the normals need one more ring of triangles around the chunk, so the vertices on the border are the same for both neighbouring chunks.
+        const int margin = m_SmoothShading ? m_SmoothingIterations + 1 : 0;
+
+        // The cubes start one voxel before the inner box and their corners end two voxels behind it.
+        SPaddedBlock block(_Chunk, accessor, _Chunk.InnerBBox.Beg - Math::Vec3i(1 + margin, 1 + margin, 1 + margin), _Chunk.InnerBBox.End - _Chunk.InnerBBox.Beg + Math::Vec3i(4 + 2 * margin, 4 + 2 * margin, 4 + 2 * margin));
+
+        int cornerOffsets[12][2];
+        for (int e = 0; e < 12; e++)
         {
-            for(int y = _Chunk.InnerBBox.Beg.y - 1; y <= _Chunk.InnerBBox.End.y + 1; y++)
+            for (int c = 0; c < 2; c++)
+                cornerOffsets[e][c] = block.Index(CORNERS[e][c].x, CORNERS[e][c].y, CORNERS[e][c].z);
+        }
+
+        const Texture palette = GetPalette(m);
+        const uint8_t *empty = block.Empty.data();
+
+        // Welded vertices of the smooth shading. Positions lie on a half voxel grid, so twice the position is a unique key.
+        std::vector<Math::Vec3f> positions;
+        std::vector<SSmoothTriangle> smoothTriangles;
+        VectoriMap<int> vertexIndex;
+
+        for(int x = 0; x < block.Size.x - 1; x++)
+        {
+            for(int y = 0; y < block.Size.y - 1; y++)
             {
-                for(int z = _Chunk.InnerBBox.Beg.z - 1; z <= _Chunk.InnerBBox.End.z + 1; z++)
+                // Columns of the four cube corners with the same z.
+                const int c0 = block.Index(x, y, 0);
+                const int c1 = block.Index(x + 1, y, 0);
+                const int c2 = block.Index(x + 1, y + 1, 0);
+                const int c3 = block.Index(x, y + 1, 0);
+
+                auto layerBits = [&](int z) {
+                    return (uint8_t)(empty[c0 + z] | (empty[c1 + z] << 1) | (empty[c2 + z] << 2) | (empty[c3 + z] << 3));
+                };
+
+                // The upper half of a cube index is the lower half of the next one.
+                uint8_t lower = layerBits(0);
+                for(int z = 0; z < block.Size.z - 1; z++)
                 {
-                    uint8_t idx = GetTableIndex(m, Math::Vec3f(x, y, z));
-                    auto edges = triangleConnectionTable[idx];
-
-                    CreateFaces(builder, m, _Chunk, Math::Vec3f(x, y, z), edges);
+                    uint8_t upper = layerBits(z + 1);
+                    uint8_t idx = lower | (upper << 4);
+                    lower = upper;
+
+                    if(idx == 0 || idx == 0xFF)
+                        continue;
+
+                    STriangle triangles[5];
+                    Math::Vec3f pos(block.Beg.x + x, block.Beg.y + y, block.Beg.z + z);
+                    int count = CreateTriangles(m, &block.Voxels[c0 + z], cornerOffsets, pos, triangleConnectionTable[idx], triangles);
+
+                    if(!m_SmoothShading)
+                    {
+                        for (int i = 0; i < count; i++)
+                            AddFlatTriangle(builder, m, palette, triangles[i]);
+
+                        continue;
+                    }
+
+                    bool emit = x >= margin && y >= margin && z >= margin && x < block.Size.x - 1 - margin && y < block.Size.y - 1 - margin && z < block.Size.z - 1 - margin;
+                    for (int i = 0; i < count; i++)
+                    {
+                        SSmoothTriangle tri;
+                        for (int j = 0; j < 3; j++)
+                        {
+                            auto it = vertexIndex.find(Math::Vec3i(triangles[i].Pos[j] * 2.f));
+                            if(it == vertexIndex.end())
+                            {
+                                it = vertexIndex.insert({Math::Vec3i(triangles[i].Pos[j] * 2.f), (int)positions.size()}).first;
+                                positions.push_back(triangles[i].Pos[j]);
+                            }
+
+                            tri.Vertices[j] = it->second;
+                            tri.Color[j] = triangles[i].Color[j];
+                        }
+
+                        tri.Material = triangles[i].Material;
+                        tri.Emit = emit;
+                        smoothTriangles.push_back(tri);
+                    }
                 }
             }
         }
 
+        if(m_SmoothShading)
+            AddSmoothTriangles(builder, m, palette, positions, smoothTriangles);
+
         SMeshChunk chunk;
         chunk.UniqueId = _Chunk.UniqueId;
         chunk.InnerBBox = _Chunk.InnerBBox;
@@ -378,67 +436,53 @@ namespace VCore
         return chunk;
     }
 
-    Voxel CMarchingCubesMesher::GetVoxel(VoxelModel m, const SChunkMeta &_Chunk, Math::Vec3f pos, int edge)
+    Voxel CMarchingCubesMesher::GetVoxel(const Voxel *_Cube, const int (*_CornerOffsets)[2], int edge)
     {
-        auto chunkDimension = CBBox(_Chunk.TotalBBox.Beg, _Chunk.TotalBBox.GetSize());
-        auto corners = Corners[edge];
-        Math::Vec3i v = pos + corners.first;
-        Voxel vox = nullptr;
-        if(_Chunk.TotalBBox.ContainsPoint(v))
-            vox = _Chunk.Chunk->findVisible(v, chunkDimension);
-        else
-            vox = m->GetVisibleVoxel(v);
-        
-        if(!vox)
-        {
-            v = pos + corners.second;
-            if(_Chunk.TotalBBox.ContainsPoint(v))
-                vox = _Chunk.Chunk->findVisible(v, chunkDimension);
-            else
-                vox = m->GetVisibleVoxel(v);
-        }
+        Voxel vox = _Cube[_CornerOffsets[edge][0]];
+        if(vox && vox->IsVisible())
+            return vox;
 
-        return vox;
+        vox = _Cube[_CornerOffsets[edge][1]];
+        if(vox && vox->IsVisible())
+            return vox;
+
+        return nullptr;
     }
 
-    Math::Vec3f GetSolidIndex(int &oldidx, Math::Vec3f idxs)
+    /**
+     * @brief Majority vote between the last solid color of a cube and the colors of a triangle. Ties are won by the lowest color index.
+     */
+    void GetSolidIndex(int &oldidx, int (&idxs)[3])
     {
-        Math::Vec4f tmpIdxs(oldidx, idxs.x, idxs.y, idxs.z);
-        std::map<int, int> counter;
+        const int values[4] = { oldidx, idxs[0], idxs[1], idxs[2] };
 
-        for (uint8_t i = 0; i < 4; i++)
-        {
-            auto IT = counter.find(tmpIdxs.v[i]);
-            if(IT != counter.end())
-                IT->second++;
-            else
-                counter[tmpIdxs.v[i]] = 1;
-        }
-        
-        int maxCount = -1;
+        int maxCount = 0;
         int idx = -1;
 
-        for (auto &&c : counter)
+        for (uint8_t i = 0; i < 4; i++)
         {
-            if(c.second > maxCount)
+            int count = 0;
+            for (uint8_t j = 0; j < 4; j++)
+                count += values[i] == values[j];
+
+            if(count > maxCount || (count == maxCount && values[i] < idx))
             {
-                maxCount = c.second;
-                idx = c.first;
+                maxCount = count;
+                idx = values[i];
             }
         }
 
         if(maxCount > 1)
         {
-            idxs = Math::Vec3f(idx, idx, idx);
+            idxs[0] = idxs[1] = idxs[2] = idx;
             oldidx = idx;
-        }   
-
-        return idxs;     
+        }
     }
 
-    void CMarchingCubesMesher::CreateFaces(CMeshBuilder &builder, VoxelModel m, const SChunkMeta &_Chunk, Math::Vec3f pos, short *edges)
+    int CMarchingCubesMesher::CreateTriangles(VoxelModel m, const Voxel *_Cube, const int (*_CornerOffsets)[2], Math::Vec3f pos, const short *edges, STriangle *_Triangles)
     {
         int cidxtmp = -1;
+        int count = 0;
 
         for (size_t i = 0; i < 15; i += 3)
         {
@@ -449,47 +493,118 @@ namespace VCore
             if(e1 == -1)
                 break;
 
-            SVertex v1, v2, v3;
-
-            v1.Pos = pos + positionTable[e1] + Math::Vec3f(1, 1, 1);
-            v2.Pos = pos + positionTable[e2] + Math::Vec3f(1, 1, 1);
-            v3.Pos = pos + positionTable[e3] + Math::Vec3f(1, 1, 1);
-
-            v1.Pos = v1.Pos * Math::Vec3f(1, 1, 1);
-            v2.Pos = v2.Pos * Math::Vec3f(1, 1, 1);
-            v3.Pos = v3.Pos * Math::Vec3f(1, 1, 1);
-
-            auto voxel1 = GetVoxel(m, _Chunk, pos, e1);
-            auto voxel2 = GetVoxel(m, _Chunk, pos, e2);
-            auto voxel3 = GetVoxel(m, _Chunk, pos, e3);
+            auto voxel1 = GetVoxel(_Cube, _CornerOffsets, e1);
+            auto voxel2 = GetVoxel(_Cube, _CornerOffsets, e2);
+            auto voxel3 = GetVoxel(_Cube, _CornerOffsets, e3);
             if(!voxel1 || !voxel2 || !voxel3)
                 continue;
 
-            Math::Vec3f color(voxel1->Color, voxel2->Color, voxel3->Color);
-            color = GetSolidIndex(cidxtmp, color);
-
-            auto texture = m->Textures[TextureType::DIFFIUSE];
+            STriangle &tri = _Triangles[count++];
+            tri.Pos[0] = pos + positionTable[e1] + Math::Vec3f(1, 1, 1);
+            tri.Pos[1] = pos + positionTable[e2] + Math::Vec3f(1, 1, 1);
+            tri.Pos[2] = pos + positionTable[e3] + Math::Vec3f(1, 1, 1);
 
-            v1.UV = Math::Vec2f(((float)(color.x + 0.5f)) / texture->GetSize().x, 0.5f);
-            v2.UV = Math::Vec2f(((float)(color.y + 0.5f)) / texture->GetSize().x, 0.5f);
-            v3.UV = Math::Vec2f(((float)(color.z + 0.5f)) / texture->GetSize().x, 0.5f);
-
-            Material mat;
+            tri.Color[0] = voxel1->Color;
+            tri.Color[1] = voxel2->Color;
+            tri.Color[2] = voxel3->Color;
+            GetSolidIndex(cidxtmp, tri.Color);
 
+            tri.Material = -1;
             if(!m->Materials.empty())
             {
                 if(voxel1->Material == voxel2->Material || voxel1->Material == voxel3->Material)
-                    mat = m->Materials[voxel1->Material];
+                    tri.Material = voxel1->Material;
                 else if(voxel2->Material == voxel3->Material)
-                    mat = m->Materials[voxel2->Material];
+                    tri.Material = voxel2->Material;
                 else
-                    mat = m->Materials[voxel1->Material];
+                    tri.Material = voxel1->Material;
             }
+        }
 
-            Math::Vec3f FaceNormal = (v2.Pos - v1.Pos).cross(v3.Pos - v1.Pos).normalize(); 
-            v1.Normal = v2.Normal = v3.Normal = FaceNormal;
+        return count;
+    }
+
+    void CMarchingCubesMesher::AddFlatTriangle(CMeshBuilder &builder, VoxelModel m, const Texture &_Palette, const STriangle &_Triangle)
+    {
+        SVertex v1, v2, v3;
+
+        v1.Pos = _Triangle.Pos[0];
+        v2.Pos = _Triangle.Pos[1];
+        v3.Pos = _Triangle.Pos[2];
+
+        v1.UV = GetColorUV(_Palette, _Triangle.Color[0]);
+        v2.UV = GetColorUV(_Palette, _Triangle.Color[1]);
+        v3.UV = GetColorUV(_Palette, _Triangle.Color[2]);
+
+        Material mat;
+        if(_Triangle.Material != -1)
+            mat = m->Materials[_Triangle.Material];
+
+        Math::Vec3f FaceNormal = (v2.Pos - v1.Pos).cross(v3.Pos - v1.Pos).normalize(); 
+        v1.Normal = v2.Normal = v3.Normal = FaceNormal;
+
+        builder.AddFace(v1, v2, v3, mat);
+    }
+
+    void CMarchingCubesMesher::AddSmoothTriangles(CMeshBuilder &builder, VoxelModel m, const Texture &_Palette, std::vector<Math::Vec3f> &_Positions, const std::vector<SSmoothTriangle> &_Triangles)
+    {
+        // The triangles are sorted by their cube, so every vertex sums up its neighbours in the same order in each chunk.
+        std::vector<Math::Vec3f> sums(_Positions.size());
+        std::vector<int> counts(_Positions.size());
+        for (int pass = 0; pass < m_SmoothingIterations; pass++)
+        {
+            std::fill(sums.begin(), sums.end(), Math::Vec3f());
+            std::fill(counts.begin(), counts.end(), 0);
+
+            for (auto &&tri : _Triangles)
+            {
+                for (int j = 0; j < 3; j++)
+                {
+                    int a = tri.Vertices[j];
+                    int b = tri.Vertices[(j + 1) % 3];
+
+                    sums[a] += _Positions[b];
+                    sums[b] += _Positions[a];
+                    counts[a]++;
+                    counts[b]++;
+                }
+            }
+
+            for (size_t i = 0; i < _Positions.size(); i++)
+            {
+                if(counts[i] != 0)
+                    _Positions[i] = _Positions[i] + (sums[i] / (float)counts[i] - _Positions[i]) * 0.5f;
+            }
+        }
+
+        // Area weighted normal of each vertex.
+        std::vector<Math::Vec3f> normals(_Positions.size());
+        for (auto &&tri : _Triangles)
+        {
+            const Math::Vec3f &p1 = _Positions[tri.Vertices[0]];
+            Math::Vec3f normal = (_Positions[tri.Vertices[1]] - p1).cross(_Positions[tri.Vertices[2]] - p1);
+            for (int j = 0; j < 3; j++)
+                normals[tri.Vertices[j]] += normal;
+        }
+
+        for (auto &&tri : _Triangles)
+        {
+            if(!tri.Emit)
+                continue;
+
+            SVertex v[3];
+            for (int j = 0; j < 3; j++)
+            {
+                v[j].Pos = _Positions[tri.Vertices[j]];
+                v[j].Normal = normals[tri.Vertices[j]].normalize();
+                v[j].UV = GetColorUV(_Palette, tri.Color[j]);
+            }
+
+            Material mat;
+            if(tri.Material != -1)
+                mat = m->Materials[tri.Material];
 
-            builder.AddFace(v1, v2, v3, mat);
+            builder.AddFace(v[0], v[1], v[2], mat);
         }
     }
 }
@@ -30,18 +30,40 @@
 
 namespace VCore
 {
+    struct SSmoothTriangle;
+
     class CMarchingCubesMesher : public IMesher
     {
         public:
             CMarchingCubesMesher() : IMesher() {}
             virtual ~CMarchingCubesMesher() = default;
 
+            /**
+             * @return Returns 2, the corners of the cubes on the border of a chunk end two voxels inside of its neighbours. Smooth shading adds one voxel for the normals and for every smoothing pass.
+             */
+            int GetHaloRadius() const override { return 2 + (m_SmoothShading ? m_SmoothingIterations + 1 : 0); }
+
         protected:
             SMeshChunk GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque) override;
 
         private:
-            void CreateFaces(CMeshBuilder &builder, VoxelModel m, const SChunkMeta &_Chunk, Math::Vec3f pos, short *edges);
-            Voxel GetVoxel(VoxelModel m, const SChunkMeta &_Chunk, Math::Vec3f pos, int edge);
+            struct STriangle
+            {
+                Math::Vec3f Pos[3];
+                int Color[3];
+                int Material;   //!< Index of the material, -1 if the model has no materials.
+            };
+
+            /**
+             * @brief Creates the triangles of one cube.
+             * 
+             * @param _Triangles: Receives up to 5 triangles.
+             * @return Returns the count of created triangles.
+             */
+            int CreateTriangles(VoxelModel m, const Voxel *_Cube, const int (*_CornerOffsets)[2], Math::Vec3f pos, const short *edges, STriangle *_Triangles);
+            void AddFlatTriangle(CMeshBuilder &builder, VoxelModel m, const Texture &_Palette, const STriangle &_Triangle);
+            void AddSmoothTriangles(CMeshBuilder &builder, VoxelModel m, const Texture &_Palette, std::vector<Math::Vec3f> &_Positions, const std::vector<SSmoothTriangle> &_Triangles);
+            Voxel GetVoxel(const Voxel *_Cube, const int (*_CornerOffsets)[2], int edge);
     };
 }
 
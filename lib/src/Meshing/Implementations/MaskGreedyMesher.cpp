@@ -0,0 +1,158 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "MaskGreedyMesher.hpp"
+#include "PaddedBlock.hpp"
+#include "Slicer/FaceMask.hpp"
+#include <memory>
+#include <VCore/Meshing/MeshBuilder.hpp>
+#include <vector>
+
+namespace VCore
+{
+    struct SFaceDirection
+    {
+        int Axis;               //!< Axis of the normal.
+        bool Positive;          //!< True if the normal points along the positive axis.
+        Math::Vec3f Normal;
+    };
+
+    // Same order as the bits of CVoxel::Visibility.
+    const static SFaceDirection FACE_DIRECTIONS[6] = {
+        { 1, true, Math::Vec3f::UP },
+        { 1, false, Math::Vec3f::DOWN },
+        { 0, false, Math::Vec3f::LEFT },
+        { 0, true, Math::Vec3f::RIGHT },
+        { 2, true, Math::Vec3f::FRONT },
+        { 2, false, Math::Vec3f::BACK },
+    };
+
+    SMeshChunk CMaskGreedyMesher::GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque)
+    {
+        (void)Opaque;
+
+        CMeshBuilder builder;
+        builder.SetVertexDeduplication(m_VertexDeduplication);
+        builder.AddTextures(m->Textures);
+
+        const CBBox chunkBBox(_Chunk.TotalBBox.Beg, _Chunk.TotalBBox.GetSize());
+        const Math::Vec3i beg = _Chunk.InnerBBox.Beg;
+        const Math::Vec3i size = _Chunk.InnerBBox.End - beg + Math::Vec3i(1, 1, 1);
+
+        // Copies the voxels of the inner bbox once, so that the slices only read a flat array.
+        std::vector<uint64_t> cells(size.x * size.y * size.z, 0);
+        _Chunk.Chunk->forEachVisible(chunkBBox, [&](const Math::Vec3i &_Position, Voxel _Voxel)
+        {
+            Math::Vec3i p = _Position - beg;
+            cells[p.x + size.x * p.y + size.x * size.y * p.z] = PackFaceCell(_Voxel);
+        });
+
+        const size_t strides[3] = { 1, (size_t)size.x, (size_t)(size.x * size.y) };
+        std::vector<uint64_t> mask;
+
+        // The occlusion of a face reaches one voxel into the neighbouring chunks.
+        std::unique_ptr<SPaddedBlock> block;
+        if(m_AmbientOcclusion)
+        {
+            auto accessor = m->GetVoxels().createAccessor();
+            block = std::make_unique<SPaddedBlock>(_Chunk, accessor, beg - Math::Vec3i(1, 1, 1), size + Math::Vec3i(2, 2, 2));
+        }
+
+        for (int face = 0; face < 6; face++)
+        {
+            const SFaceDirection &dir = FACE_DIRECTIONS[face];
+            const uint8_t bit = 1 << face;
+
+            int axis = dir.Axis;
+            int heightAxis = (axis + 1) % 3; // 1 = 1 = y, 2 = 2 = z, 3 = 0 = x
+            int widthAxis = (axis + 2) % 3; // 2 = 2 = z, 3 = 0 = x, 4 = 1 = y
+
+            const int width = size.v[widthAxis];
+            const int height = size.v[heightAxis];
+            mask.resize(width * height);
+
+            for (int slice = 0; slice < size.v[axis]; slice++)
+            {
+                // Builds the mask of this slice.
+                bool empty = true;
+                for (int h = 0; h < height; h++)
+                {
+                    size_t idx = slice * strides[axis] + h * strides[heightAxis];
+                    for (int w = 0; w < width; w++, idx += strides[widthAxis])
+                    {
+                        uint64_t key = FaceMaskKey(cells[idx], bit);
+                        if(key && block)
+                        {
+                            Math::Vec3i layer;
+                            layer.v[axis] = slice + (dir.Positive ? 1 : -1);
+                            layer.v[heightAxis] = h;
+                            layer.v[widthAxis] = w;
+                            key = FaceMaskOcclusion(key, block->FaceOcclusion(block->Index(beg + layer), axis, widthAxis, heightAxis));
+                        }
+
+                        mask[w + width * h] = key;
+                        empty &= !key;
+                    }
+                }
+
+                if(empty)
+                    continue;
+
+                MergeFaceMask(mask, width, height, [&](int w, int h, int quadWidth, int quadHeight, uint64_t key)
+                {
+                    Math::Vec3f v1;
+                    v1.v[axis] = beg.v[axis] + slice + (dir.Positive ? 1 : 0);
+                    v1.v[heightAxis] = beg.v[heightAxis] + h;
+                    v1.v[widthAxis] = beg.v[widthAxis] + w;
+
+                    Math::Vec3f du, dv;
+                    du.v[widthAxis] = quadWidth;
+                    dv.v[heightAxis] = quadHeight;
+
+                    Material mat;
+                    int material = FaceCellMaterial(key);
+                    if(material < (int)m->Materials.size())
+                        mat = m->Materials[material];
+
+                    if(block)
+                    {
+                        uint8_t occlusion[4];
+                        UnpackFaceOcclusion(FaceCellOcclusion(key), occlusion);
+                        builder.AddFace(v1, v1 + du, v1 + dv, v1 + du + dv, dir.Normal, FaceCellColor(key), mat, occlusion);
+                    }
+                    else
+                        builder.AddFace(v1, v1 + du, v1 + dv, v1 + du + dv, dir.Normal, FaceCellColor(key), mat);
+                });
+            }
+        }
+
+        SMeshChunk chunk;
+        chunk.UniqueId = _Chunk.UniqueId;
+        chunk.InnerBBox = _Chunk.InnerBBox;
+        chunk.TotalBBox = _Chunk.TotalBBox;
+        chunk.MeshData = builder.Build();
+
+        return chunk;
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MASKGREEDYMESHER_HPP
+#define MASKGREEDYMESHER_HPP
+
+#include <VCore/Meshing/IMesher.hpp>
+
+namespace VCore
+{
+    /**
+     * @brief Greedy mesher, which builds a 2D face mask per slice and merges the faces of the mask in place.
+     * 
+     * The faces are taken from the visibility mask of the voxels, so no neighbour lookups are needed. Faces are only merged inside of a chunk.
+     */
+    class CMaskGreedyMesher : public IMesher
+    {
+        public:
+            CMaskGreedyMesher() : IMesher() {}
+            virtual ~CMaskGreedyMesher() = default;
+
+            /**
+             * @return Returns 1 with ambient occlusion, since the occlusion reads the neighbours of each face.
+             */
+            int GetHaloRadius() const override { return m_AmbientOcclusion ? 1 : 0; }
+
+        protected:
+            SMeshChunk GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque) override;
+    };
+}
+
+
+#endif //MASKGREEDYMESHER_HPP
@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef PADDEDBLOCK_HPP
+#define PADDEDBLOCK_HPP
+
+#include <cstdint>
+#include <vector>
+#include <VCore/Voxel/VoxelModel.hpp>
+
+namespace VCore
+{
+    /**
+     * @brief Copy of the voxels of a chunk plus a halo of its neighbours. The z axis is the fastest one, so neighbours along z are neighbours in memory.
+     */
+    struct SPaddedBlock
+    {
+        /**
+         * @brief Copies all voxels from _Beg to _Beg + _Size - 1. Voxels inside of the chunk are read directly, only the halo goes through the accessor.
+         */
+        SPaddedBlock(const SChunkMeta &_Chunk, CVoxelSpace::accessor &_Accessor, const Math::Vec3i &_Beg, const Math::Vec3i &_Size) : Beg(_Beg), Size(_Size), Voxels((size_t)_Size.x * _Size.y * _Size.z, nullptr), Empty(Voxels.size(), 1) 
+        {
+            const CBBox chunkDimension(_Chunk.TotalBBox.Beg, _Chunk.TotalBBox.GetSize());
+
+            for(int x = 0; x < Size.x; x++)
+            {
+                for(int y = 0; y < Size.y; y++)
+                {
+                    int idx = Index(x, y, 0);
+                    for(int z = 0; z < Size.z; z++, idx++)
+                    {
+                        Math::Vec3i v = Beg + Math::Vec3i(x, y, z);
+                        Voxel vox;
+                        if(_Chunk.TotalBBox.ContainsPoint(v))
+                            vox = _Chunk.Chunk->find(v, chunkDimension);
+                        else
+                            vox = _Accessor.find(v);
+
+                        Voxels[idx] = vox;
+                        Empty[idx] = vox ? 0 : 1;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Copies all voxels from _Beg to _Beg + _Size - 1 through the accessor. Used for areas spanning several chunks.
+         */
+        SPaddedBlock(CVoxelSpace::accessor &_Accessor, const Math::Vec3i &_Beg, const Math::Vec3i &_Size) : Beg(_Beg), Size(_Size), Voxels((size_t)_Size.x * _Size.y * _Size.z, nullptr), Empty(Voxels.size(), 1) 
+        {
+            for(int x = 0; x < Size.x; x++)
+            {
+                for(int y = 0; y < Size.y; y++)
+                {
+                    int idx = Index(x, y, 0);
+                    for(int z = 0; z < Size.z; z++, idx++)
+                    {
+                        Voxel vox = _Accessor.find(Beg + Math::Vec3i(x, y, z));
+                        Voxels[idx] = vox;
+                        Empty[idx] = vox ? 0 : 1;
+                    }
+                }
+            }
+        }
+
+        inline int Index(int _x, int _y, int _z) const
+        {
+            return _z + Size.z * (_y + Size.y * _x);
+        }
+
+        inline int Index(const Math::Vec3i &_Pos) const
+        {
+            return Index(_Pos.x - Beg.x, _Pos.y - Beg.y, _Pos.z - Beg.z);
+        }
+
+        /**
+         * @brief Ambient occlusion of a face corner, from the two voxels beside the corner and the one diagonal to it.
+         * 
+         * @param _Layer: Index of the empty voxel in front of the face.
+         * @param _Axis: Axis of the face normal.
+         * @param _Corner: Corner of the face relative to its voxel, only the two axes of the face plane are used.
+         * @return Returns 0 for a fully occluded corner up to 3 for a free one.
+         */
+        inline uint8_t Occlusion(int _Layer, int _Axis, const Math::Vec3i &_Corner) const
+        {
+            const int strides[3] = { Size.y * Size.z, Size.z, 1 };
+            const int a1 = (_Axis + 1) % 3;
+            const int a2 = (_Axis + 2) % 3;
+            const int s1 = _Corner.v[a1] ? strides[a1] : -strides[a1];
+            const int s2 = _Corner.v[a2] ? strides[a2] : -strides[a2];
+
+            int side1 = Empty[_Layer + s1] ^ 1;
+            int side2 = Empty[_Layer + s2] ^ 1;
+            if(side1 && side2)
+                return 0;
+
+            return 3 - side1 - side2 - (Empty[_Layer + s1 + s2] ^ 1);
+        }
+
+        /**
+         * @brief Occlusion of the 4 corners of a quad with the corners (0, 0), (1, 0), (0, 1) and (1, 1) on the _WidthAxis and _HeightAxis, 2 bits per corner.
+         */
+        inline uint8_t FaceOcclusion(int _Layer, int _Axis, int _WidthAxis, int _HeightAxis) const
+        {
+            uint8_t ret = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                Math::Vec3i corner;
+                corner.v[_WidthAxis] = i & 1;
+                corner.v[_HeightAxis] = i >> 1;
+                ret |= Occlusion(_Layer, _Axis, corner) << (i * 2);
+            }
+
+            return ret;
+        }
+
+        Math::Vec3i Beg;
+        Math::Vec3i Size;
+        std::vector<Voxel> Voxels;      //!< Instantiated voxels, nullptr for empty cells.
+        std::vector<uint8_t> Empty;     //!< 1 for every empty cell.
+    };
+}
+
+#endif //PADDEDBLOCK_HPP
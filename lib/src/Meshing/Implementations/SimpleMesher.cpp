@@ -23,25 +23,29 @@
  */
 
 #include "SimpleMesher.hpp"
+#include "PaddedBlock.hpp"
 #include <algorithm>
+#include <memory>
 #include <VCore/Meshing/MeshBuilder.hpp>
+#include <VCore/Misc/Bits.hpp>
 
 namespace VCore
 {
     struct SFaceInfo
     {
         Math::Vec3f V1, V2, V3, V4, Normal;   
+        int Axis;   //!< Axis of the normal.
     };
 
     const static SFaceInfo FACE_INFOS[6] = {
-        { { 0, 1, 0 }, { 1, 1, 0 }, { 0, 1, 1 }, { 1, 1, 1 }, Math::Vec3f::UP },
-        { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 0, 1 }, { 1, 0, 1 }, Math::Vec3f::DOWN },
+        { { 0, 1, 0 }, { 1, 1, 0 }, { 0, 1, 1 }, { 1, 1, 1 }, Math::Vec3f::UP, 1 },
+        { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 0, 1 }, { 1, 0, 1 }, Math::Vec3f::DOWN, 1 },
 
-        { { 0, 1, 0 }, { 0, 1, 1 }, { 0, 0, 0 }, { 0, 0, 1 }, Math::Vec3f::LEFT },
-        { { 1, 1, 0 }, { 1, 1, 1 }, { 1, 0, 0 }, { 1, 0, 1 }, Math::Vec3f::RIGHT },
+        { { 0, 1, 0 }, { 0, 1, 1 }, { 0, 0, 0 }, { 0, 0, 1 }, Math::Vec3f::LEFT, 0 },
+        { { 1, 1, 0 }, { 1, 1, 1 }, { 1, 0, 0 }, { 1, 0, 1 }, Math::Vec3f::RIGHT, 0 },
 
-        { { 0, 1, 1 }, { 1, 1, 1 }, { 0, 0, 1 }, { 1, 0, 1 }, Math::Vec3f::FRONT },
-        { { 0, 1, 0 }, { 1, 1, 0 }, { 0, 0, 0 }, { 1, 0, 0 }, Math::Vec3f::BACK },
+        { { 0, 1, 1 }, { 1, 1, 1 }, { 0, 0, 1 }, { 1, 0, 1 }, Math::Vec3f::FRONT, 2 },
+        { { 0, 1, 0 }, { 1, 1, 0 }, { 0, 0, 0 }, { 1, 0, 0 }, Math::Vec3f::BACK, 2 },
     };
 
     SMeshChunk CSimpleMesher::GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque)
@@ -49,37 +53,105 @@ namespace VCore
         (void)Opaque;
 
         CMeshBuilder builder;
+        builder.SetVertexDeduplication(m_VertexDeduplication);
         builder.AddTextures(m->Textures);
 
         if(m->TexturingType == TexturingTypes::TEXTURED)
             builder.SetTextureMap(&m->TextureMapping);
 
         const CBBox chunkBBox(_Chunk.TotalBBox.Beg, _Chunk.TotalBBox.GetSize());
-        for(int x = _Chunk.InnerBBox.Beg.x; x <= _Chunk.InnerBBox.End.x; x++)
+
+        // Counts the faces of each material, so that the builder allocates its buffers only once. The last entry counts the faces without a material.
+        std::vector<size_t> faces(m->Materials.size() + 1, 0);
+        _Chunk.Chunk->forEachVisible(chunkBBox, [&](const Math::Vec3i &, Voxel _Voxel)
+        {
+            faces[std::min<size_t>(_Voxel->Material, m->Materials.size())] += PopCount((uint8_t)_Voxel->VisibilityMask);
+        });
+
+        for (size_t i = 0; i < faces.size(); i++)
+        {
+            if(faces[i])
+                builder.Reserve(i < m->Materials.size() ? m->Materials[i] : Material(), faces[i] * 4, faces[i] * 6);
+        }
+
+        // The occlusion of a face reaches one voxel into the neighbouring chunks.
+        std::unique_ptr<SPaddedBlock> block;
+        if(m_AmbientOcclusion)
+        {
+            auto accessor = m->GetVoxels().createAccessor();
+            block = std::make_unique<SPaddedBlock>(_Chunk, accessor, _Chunk.InnerBBox.Beg - Math::Vec3i(1, 1, 1), _Chunk.InnerBBox.End - _Chunk.InnerBBox.Beg + Math::Vec3i(3, 3, 3));
+        }
+
+        auto addFaces = [&](const Math::Vec3i &vpos, Voxel v)
         {
-            for(int y = _Chunk.InnerBBox.Beg.y; y <= _Chunk.InnerBBox.End.y; y++)
+            for (uint8_t i = 0; i < 6; i++)
             {
-                for(int z = _Chunk.InnerBBox.Beg.z; z <= _Chunk.InnerBBox.End.z; z++)
+                CVoxel::Visibility visiblity = (CVoxel::Visibility )((uint8_t)v->VisibilityMask & (uint8_t)(1 << i));
+
+                // Invisible
+                if(visiblity == CVoxel::Visibility::INVISIBLE)
+                    continue;
+
+                Material mat;
+                if(v->Material < (short)m->Materials.size())
+                    mat = m->Materials[v->Material];
+
+                auto info = FACE_INFOS[i];
+                if(block)
                 {
-                    Math::Vec3i vpos(x, y, z);
-                    Voxel v = _Chunk.Chunk->findVisible(vpos, chunkBBox);
-                    if(v)
-                    {
-                        for (uint8_t i = 0; i < 6; i++)
-                        {
-                            CVoxel::Visibility visiblity = (CVoxel::Visibility )((uint8_t)v->VisibilityMask & (uint8_t)(1 << i));
+                    int layer = block->Index(vpos + Math::Vec3i(info.Normal));
+                    uint8_t occlusion[4] = {
+                        block->Occlusion(layer, info.Axis, Math::Vec3i(info.V1)),
+                        block->Occlusion(layer, info.Axis, Math::Vec3i(info.V2)),
+                        block->Occlusion(layer, info.Axis, Math::Vec3i(info.V3)),
+                        block->Occlusion(layer, info.Axis, Math::Vec3i(info.V4)),
+                    };
+
+                    builder.AddFace((info.V1 + vpos), (info.V2 + vpos), (info.V3 + vpos), (info.V4 + vpos), info.Normal, v->Color, mat, occlusion);
+                }
+                else
+                    builder.AddFace((info.V1 + vpos), (info.V2 + vpos), (info.V3 + vpos), (info.V4 + vpos), info.Normal, v->Color, mat);
+            }
+        };
 
-                            // Invisible
-                            if(visiblity == CVoxel::Visibility::INVISIBLE)
-                                continue;
+        if(_Chunk.Chunk->hasRowMasks())
+        {
+            // Only visits instantiated voxels, by walking the set bits of each row.
+            const Math::Vec3i &size = chunkBBox.End;
+            const Math::Vec3i beg = _Chunk.InnerBBox.Beg - chunkBBox.Beg;
+            const Math::Vec3i end = _Chunk.InnerBBox.End - chunkBBox.Beg;
+            const uint64_t regionMask = BitRange(beg.x, end.x);
 
-                            Material mat;
-                            if(v->Material < (short)m->Materials.size())
-                                mat = m->Materials[v->Material];
+            for(int z = beg.z; z <= end.z; z++)
+            {
+                for(int y = beg.y; y <= end.y; y++)
+                {
+                    uint64_t bits = _Chunk.Chunk->occupancy(y, z, size) & regionMask;
+                    while(bits)
+                    {
+                        int x = CountTrailingZeros(bits);
+                        bits &= bits - 1;
 
-                            auto info = FACE_INFOS[i];
-                            builder.AddFace((info.V1 + vpos), (info.V2 + vpos), (info.V3 + vpos), (info.V4 + vpos), info.Normal, v->Color, mat);
-                        }
+                        Math::Vec3i vpos = chunkBBox.Beg + Math::Vec3i(x, y, z);
+                        Voxel v = _Chunk.Chunk->findVisible(vpos, chunkBBox);
+                        if(v)
+                            addFaces(vpos, v);
+                    }
+                }
+            }
+        }
+        else
+        {
+            for(int x = _Chunk.InnerBBox.Beg.x; x <= _Chunk.InnerBBox.End.x; x++)
+            {
+                for(int y = _Chunk.InnerBBox.Beg.y; y <= _Chunk.InnerBBox.End.y; y++)
+                {
+                    for(int z = _Chunk.InnerBBox.Beg.z; z <= _Chunk.InnerBBox.End.z; z++)
+                    {
+                        Math::Vec3i vpos(x, y, z);
+                        Voxel v = _Chunk.Chunk->findVisible(vpos, chunkBBox);
+                        if(v)
+                            addFaces(vpos, v);
                     }
                 }
             }
@@ -35,6 +35,11 @@ namespace VCore
             CSimpleMesher() : IMesher() {}
             virtual ~CSimpleMesher() = default;
 
+            /**
+             * @return Returns 1 with ambient occlusion, since the occlusion reads the neighbours of each face.
+             */
+            int GetHaloRadius() const override { return m_AmbientOcclusion ? 1 : 0; }
+
         protected:
             SMeshChunk GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque) override;
     };
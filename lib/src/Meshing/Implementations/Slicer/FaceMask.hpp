@@ -0,0 +1,132 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FACEMASK_HPP
+#define FACEMASK_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <VCore/Voxel/Voxel.hpp>
+
+namespace VCore
+{
+    const uint64_t FACE_CELL_KEY = ~(uint64_t)0xFF;                 //!< Color and material bits of a face cell.
+    const uint64_t FACE_CELL_MATERIAL = (uint64_t)0xFFFF << 8;      //!< Material bits of a face cell.
+    const int FACE_CELL_OCCLUSION = 24;                             //!< First bit of the ambient occlusion inside of a mask value, which is unused by the cell.
+
+    /**
+     * @brief Packs color, material and visibility mask of a voxel into one value.
+     */
+    inline uint64_t PackFaceCell(const CVoxel *_Voxel)
+    {
+        return ((uint64_t)(uint32_t)_Voxel->Color << 32) | ((uint64_t)(uint16_t)_Voxel->Material << 8) | (uint8_t)_Voxel->VisibilityMask;
+    }
+
+    /**
+     * @return Returns the mask value of a cell for the given face bit. Only the bits of _Key are compared by the merge, 0 means no face.
+     */
+    inline uint64_t FaceMaskKey(uint64_t _Cell, uint8_t _Face, uint64_t _Key = FACE_CELL_KEY)
+    {
+        return (_Cell & _Face) ? ((_Cell & _Key) | 1) : 0;
+    }
+
+    /**
+     * @brief Adds the ambient occlusion of the 4 face corners to a mask value, so only faces with the same occlusion are merged.
+     */
+    inline uint64_t FaceMaskOcclusion(uint64_t _MaskValue, uint8_t _Occlusion)
+    {
+        return _MaskValue ? (_MaskValue | ((uint64_t)_Occlusion << FACE_CELL_OCCLUSION)) : 0;
+    }
+
+    inline uint8_t FaceCellOcclusion(uint64_t _MaskValue)
+    {
+        return (uint8_t)(_MaskValue >> FACE_CELL_OCCLUSION);
+    }
+
+    /**
+     * @brief Unpacks the occlusion of FaceMaskOcclusion into one value per corner.
+     */
+    inline void UnpackFaceOcclusion(uint8_t _Occlusion, uint8_t (&_Corners)[4])
+    {
+        for (int i = 0; i < 4; i++)
+            _Corners[i] = (_Occlusion >> (i * 2)) & 3;
+    }
+
+    inline int FaceCellColor(uint64_t _Cell)
+    {
+        return (int)(CVoxel::ColorIndex)(_Cell >> 32);
+    }
+
+    inline int FaceCellMaterial(uint64_t _Cell)
+    {
+        return (int)(CVoxel::MaterialIndex)((_Cell >> 8) & 0xFFFF);
+    }
+
+    /**
+     * @brief Merges equal, neighbouring mask values into rectangles. Each rectangle is cleared from the mask and passed to _Fn(int _X, int _Y, int _Width, int _Height, uint64_t _Key).
+     * 
+     * @param _Mask: Row major mask of _Width * _Height values.
+     */
+    template<class Fn>
+    inline void MergeFaceMask(std::vector<uint64_t> &_Mask, int _Width, int _Height, Fn &&_Fn)
+    {
+        for (int h = 0; h < _Height; h++)
+        {
+            for (int w = 0; w < _Width;)
+            {
+                uint64_t key = _Mask[w + _Width * h];
+                if(!key)
+                {
+                    w++;
+                    continue;
+                }
+
+                int quadWidth = 1;
+                while(w + quadWidth < _Width && _Mask[w + quadWidth + _Width * h] == key)
+                    quadWidth++;
+
+                int quadHeight = 1;
+                for (; h + quadHeight < _Height; quadHeight++)
+                {
+                    const uint64_t *row = &_Mask[w + _Width * (h + quadHeight)];
+                    int k = 0;
+                    while(k < quadWidth && row[k] == key)
+                        k++;
+
+                    if(k != quadWidth)
+                        break;
+                }
+
+                for (int y = 0; y < quadHeight; y++)
+                    std::fill_n(&_Mask[w + _Width * (h + y)], quadWidth, 0);
+
+                _Fn(w, h, quadWidth, quadHeight, key);
+                w += quadWidth;
+            }
+        }
+    }
+}
+
+#endif //FACEMASK_HPP
@@ -26,7 +26,6 @@
 #define SLICES_HPP
 
 #include <map>
-#include <VCore/Misc/unordered_dense.h>
 #include <vector>
 #include <VCore/Math/Vector.hpp>
 #include <VCore/Meshing/Texture.hpp>
@@ -37,15 +36,12 @@ namespace VCore
 
     using Quad = std::pair<Math::Vec3i, Math::Vec3i>;
     using Quads = std::vector<CQuadInfo>;
-    using Slice = std::map<int, Quads>;
-    using Slices = ankerl::unordered_dense::map<int, Slice>;
 
     class CQuadInfo
     {
         public:
             CQuadInfo() = default;
             CQuadInfo(const Quad &_Quad, const Math::Vec3i &_Normal, int _Material, int _Color) : mQuad(_Quad), Normal(_Normal), Material(_Material), Color(_Color) {}
-            CQuadInfo(const Quad &_Quad, const Math::Vec3i &_Normal, int _Material, const std::map<TextureType, std::vector<CColor>> &_RawTextures) : CQuadInfo(_Quad, _Normal, _Material, 0) { RawTextures = _RawTextures; }
             CQuadInfo(CQuadInfo &&_Other) { *this = std::move(_Other); }
             CQuadInfo(const CQuadInfo &_Other) { *this = _Other; }
 
@@ -55,7 +51,8 @@ namespace VCore
                 Normal = std::move(_Other.Normal);
                 Material = std::move(_Other.Material);
                 Color = std::move(_Other.Color);
-                RawTextures = std::move(_Other.RawTextures);
+                PixelOffset = _Other.PixelOffset;
+                Occlusion = _Other.Occlusion;
                 return *this;
             }
 
@@ -65,7 +62,8 @@ namespace VCore
                 Normal = _Other.Normal;
                 Material = _Other.Material;
                 Color = _Other.Color;
-                RawTextures = _Other.RawTextures;
+                PixelOffset = _Other.PixelOffset;
+                Occlusion = _Other.Occlusion;
                 return *this;
             }
 
@@ -74,55 +72,15 @@ namespace VCore
             int Material;
             int Color;
             Math::Vec2ui UvStart;
-
-            std::map<TextureType, std::vector<CColor>> RawTextures;
+            uint8_t Occlusion = 0xFF;   //!< Ambient occlusion of the 4 corners, 2 bits each. 0xFF is no occlusion.
+            size_t PixelOffset = 0;     //!< Offset of the first pixel of a textured quad in the pixel arena of its layer. The pixels are stored row by row, the stride is the quad width.
     };
 
-    class CSliceCollection
+    struct SQuadLayer
     {
-        public:
-            Slices mSlices[3];
-            std::map<TextureType, Texture> Textures;
-
-            CSliceCollection() = default;
-            CSliceCollection(CSliceCollection &&_Other) { *this = std::move(_Other); }
-
-            CSliceCollection &operator=(CSliceCollection &&_Other)
-            {
-                for (size_t i = 0; i < 3; i++)
-                    mSlices[i] = std::move(_Other.mSlices[i]);
-                Textures = std::move(_Other.Textures);
-                return *this;
-            }
-
-            /**
-             * @brief Tries to combine as many quads into one as possible.
-             */
-            void Optimize(bool _GenerateTexture);
-
-            /**
-             * @brief Merges an another collection into this one.
-             */
-            void Merge(const CSliceCollection &_Other);
-
-            /**
-             * @brief Adds a new slice to the given axis.
-             */
-            void AddSlice(int _Axis, int _Depth);
-
-            /**
-             * @brief Adds a new quad info to a given axis.
-             */
-            void AddQuadInfo(int _Axis, int _Depth, int _Height, const CQuadInfo &_Info);
-
-        private:
-            /**
-             * @brief Finds the best spot to insert other quads later.
-             * Uses a binary search operation to quickly find the position.
-            */
-            Quads::const_iterator FindInsertionPoint(const Quads &_Haystack, const Math::Vec3i &_Pos);
-
-            Quads::const_iterator FindQuad(const Quads &_Haystack, const Math::Vec3i &_Pos);
+        int Axis;
+        Quads Faces;
+        std::map<TextureType, std::vector<uint32_t>> Pixels;   //!< Pixel arena of all textured quads of the layer.
     };
 } // namespace VCore
 
@@ -0,0 +1,205 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "SurfaceNetsMesher.hpp"
+#include "PaddedBlock.hpp"
+#include <utility>
+#include <VCore/Meshing/MeshBuilder.hpp>
+
+namespace VCore
+{
+    /**
+     * @brief Vertex offset and normal for each of the 256 corner configurations of a cell. Bit i of a configuration is set, if the corner (i & 1, (i >> 1) & 1, (i >> 2) & 1) is solid.
+     */
+    struct SCellTable
+    {
+        SCellTable()
+        {
+            for (int mask = 0; mask < 256; mask++)
+            {
+                // The vertex is the center of all crossed edges.
+                Math::Vec3f sum;
+                int crossings = 0;
+                for (int a = 0; a < 8; a++)
+                {
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        int b = a | (1 << axis);
+                        if(b == a || ((mask >> a) & 1) == ((mask >> b) & 1))
+                            continue;
+
+                        sum += (Corner(a) + Corner(b)) * 0.5f;
+                        crossings++;
+                    }
+                }
+
+                Offset[mask] = crossings ? sum / (float)crossings : Math::Vec3f(0.5, 0.5, 0.5);
+
+                // Points from the solid to the empty corners.
+                Math::Vec3f normal;
+                for (int i = 0; i < 8; i++)
+                    normal += (Corner(i) - Math::Vec3f(0.5, 0.5, 0.5)) * (((mask >> i) & 1) ? -1.f : 1.f);
+
+                Normal[mask] = normal.normalize();
+            }
+        }
+
+        static Math::Vec3f Corner(int _Idx)
+        {
+            return Math::Vec3f(_Idx & 1, (_Idx >> 1) & 1, (_Idx >> 2) & 1);
+        }
+
+        Math::Vec3f Offset[256];
+        Math::Vec3f Normal[256];
+    };
+
+    const static SCellTable CELL_TABLE;
+
+    SMeshChunk CSurfaceNetsMesher::GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque)
+    {
+        (void)Opaque;
+
+        CMeshBuilder builder;
+        builder.AddTextures(m->Textures);
+
+        // Each call has its own accessor, since this method runs on multiple threads.
+        auto accessor = m->GetVoxels().createAccessor();
+
+        // The quads of a voxel need the cells on both sides of it, which reach one voxel into the neighbours.
+        SPaddedBlock block(_Chunk, accessor, _Chunk.InnerBBox.Beg - Math::Vec3i(1, 1, 1), _Chunk.InnerBBox.End - _Chunk.InnerBBox.Beg + Math::Vec3i(3, 3, 3));
+        const uint8_t *empty = block.Empty.data();
+
+        // Corner configuration of each cell, the cell is addressed by its lowest corner.
+        std::vector<uint8_t> cells(block.Empty.size(), 0);
+        for(int x = 0; x < block.Size.x - 1; x++)
+        {
+            for(int y = 0; y < block.Size.y - 1; y++)
+            {
+                const int c0 = block.Index(x, y, 0);
+                const int c1 = block.Index(x + 1, y, 0);
+                const int c2 = block.Index(x, y + 1, 0);
+                const int c3 = block.Index(x + 1, y + 1, 0);
+
+                auto layerBits = [&](int z) {
+                    return (uint8_t)((empty[c0 + z] ^ 1) | ((empty[c1 + z] ^ 1) << 1) | ((empty[c2 + z] ^ 1) << 2) | ((empty[c3 + z] ^ 1) << 3));
+                };
+
+                // The upper half of a configuration is the lower half of the next one.
+                uint8_t lower = layerBits(0);
+                for(int z = 0; z < block.Size.z - 1; z++)
+                {
+                    uint8_t upper = layerBits(z + 1);
+                    cells[c0 + z] = lower | (upper << 4);
+                    lower = upper;
+                }
+            }
+        }
+
+        const Texture palette = GetPalette(m);
+        const int strides[3] = { block.Index(1, 0, 0), block.Index(0, 1, 0), block.Index(0, 0, 1) };
+
+        auto cellVertex = [&](int _Cell, int _Color, const Math::Vec3f &_Fallback) {
+            int x = _Cell / strides[0];
+            int y = (_Cell % strides[0]) / strides[1];
+            int z = _Cell % strides[1];
+
+            uint8_t mask = cells[_Cell];
+            SVertex v;
+            v.Pos = Math::Vec3f(block.Beg.x + x, block.Beg.y + y, block.Beg.z + z) + CELL_TABLE.Offset[mask] + Math::Vec3f(0.5, 0.5, 0.5);
+            v.Normal = CELL_TABLE.Normal[mask];
+
+            // Ambiguous configurations may point away from the quad, then the quad uses its axis instead.
+            if(v.Normal.dot(_Fallback) <= 0)
+                v.Normal = _Fallback;
+
+            v.UV = GetColorUV(palette, _Color);
+            return v;
+        };
+
+        for(int x = 1; x < block.Size.x - 1; x++)
+        {
+            for(int y = 1; y < block.Size.y - 1; y++)
+            {
+                for(int z = 1; z < block.Size.z - 1; z++)
+                {
+                    int idx = block.Index(x, y, z);
+                    Voxel v = block.Voxels[idx];
+                    if(!v)
+                        continue;
+
+                    Material mat;
+                    if(v->Material < (short)m->Materials.size())
+                        mat = m->Materials[v->Material];
+
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        const int u = strides[(axis + 1) % 3];
+                        const int w = strides[(axis + 2) % 3];
+
+                        for (int sign = -1; sign <= 1; sign += 2)
+                        {
+                            int neighbour = idx + sign * strides[axis];
+                            if(!empty[neighbour])
+                                continue;
+
+                            // The crossed edge starts at the lower one of both voxels, the 4 cells around it lie below it on the other two axes.
+                            int lo = sign > 0 ? idx : neighbour;
+                            Math::Vec3f normal;
+                            normal.v[axis] = (float)sign;
+
+                            SVertex q00 = cellVertex(lo - u - w, v->Color, normal);
+                            SVertex q10 = cellVertex(lo - w, v->Color, normal);
+                            SVertex q11 = cellVertex(lo, v->Color, normal);
+                            SVertex q01 = cellVertex(lo - u, v->Color, normal);
+
+                            // Flips the winding, so the face points away from the solid voxel.
+                            if(sign < 0)
+                                std::swap(q10, q01);
+
+                            // Splits the quad along its shorter diagonal.
+                            if((q11.Pos - q00.Pos).length() <= (q01.Pos - q10.Pos).length())
+                            {
+                                builder.AddFace(q00, q10, q11, mat);
+                                builder.AddFace(q00, q11, q01, mat);
+                            }
+                            else
+                            {
+                                builder.AddFace(q00, q10, q01, mat);
+                                builder.AddFace(q10, q11, q01, mat);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        SMeshChunk chunk;
+        chunk.UniqueId = _Chunk.UniqueId;
+        chunk.InnerBBox = _Chunk.InnerBBox;
+        chunk.TotalBBox = _Chunk.TotalBBox;
+        chunk.MeshData = builder.Build();
+        return chunk;
+    }
+}
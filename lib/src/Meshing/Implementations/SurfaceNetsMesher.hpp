@@ -0,0 +1,55 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SURFACENETSMESHER_HPP
+#define SURFACENETSMESHER_HPP
+
+#include <VCore/Meshing/IMesher.hpp>
+
+namespace VCore
+{
+    /**
+     * @brief Smooth mesher, which places one vertex in each cell between 8 voxel centers, which is crossed by the surface, and connects the vertices of the 4 cells around each crossed edge to a quad.
+     * 
+     * Each quad belongs to the solid voxel of its edge, so every quad is created exactly once by the chunk of this voxel. The vertex normals only depend on the 8 voxels of a cell, so neighbouring chunks fit together seamlessly.
+     */
+    class CSurfaceNetsMesher : public IMesher
+    {
+        public:
+            CSurfaceNetsMesher() : IMesher() {}
+            virtual ~CSurfaceNetsMesher() = default;
+
+            /**
+             * @return Returns 1, the cells on the border of a chunk span the voxels of its neighbours.
+             */
+            int GetHaloRadius() const override { return 1; }
+
+        protected:
+            SMeshChunk GenerateMeshChunk(VoxelModel m, const SChunkMeta &_Chunk, bool Opaque) override;
+    };
+}
+
+
+#endif //SURFACENETSMESHER_HPP
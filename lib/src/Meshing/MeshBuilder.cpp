@@ -22,6 +22,7 @@
  * SOFTWARE.
  */
 
+#include <cmath>
 #include <VCore/Meshing/MeshBuilder.hpp>
 #include <VCore/Misc/Exceptions.hpp>
 
@@ -32,6 +33,29 @@ namespace VCore
         m_Textures = &_textures;
     }
 
+    void CMeshBuilder::Reserve(Material _Material, size_t _Vertices, size_t _Indices)
+    {
+        auto &surface = GetSurface(_Material);
+        surface.Surface.Reserve(surface.Surface.Size() + _Vertices);
+        surface.Surface.Indices.reserve(surface.Surface.Indices.size() + _Indices);
+        if(m_VertexDeduplication)
+            surface.Index.reserve(surface.Index.size() + _Vertices);
+    }
+
+    CMeshBuilder::SIndexedSurface &CMeshBuilder::GetSurface(const Material &_Material)
+    {
+        auto it = m_Surfaces.find((size_t)_Material.get());
+        if(it == m_Surfaces.end())
+        {
+            it = m_Surfaces.insert({(size_t)_Material.get(), SIndexedSurface(_Material)}).first;
+
+            // The insertion may move all surfaces.
+            m_CachedSurface = nullptr;
+        }
+
+        return it->second;
+    }
+
     int CMeshBuilder::AddVertex(const SVertex &_Vertex, SIndexedSurface &_Surface)
     {
         auto it = _Surface.Index.find(_Vertex);
@@ -46,19 +70,8 @@ namespace VCore
         return it->second;
     }
 
-    void CMeshBuilder::AddFace(Math::Vec3f _v1, Math::Vec3f _v2, Math::Vec3f _v3, Math::Vec3f _v4, Math::Vec3f _normal, int _color, Material _material)
+    void CMeshBuilder::AddFace(Math::Vec3f _v1, Math::Vec3f _v2, Math::Vec3f _v3, Math::Vec3f _v4, Math::Vec3f _normal, int _color, Material _material, const uint8_t *_occlusion)
     {
-        if(!m_CachedSurface || m_CachedSurface->Surface.FaceMaterial != _material)
-        {
-            auto it = m_Surfaces.find((size_t)_material.get());
-            if(it == m_Surfaces.end())
-                it = m_Surfaces.insert({(size_t)_material.get(), SIndexedSurface(_material)}).first;
-            m_CachedSurface = &it->second;
-            m_CachedSurface->Index.reserve(100);
-        }
-
-        Math::Vec3f faceNormal = (_v2 - _v1).cross(_v3 - _v1).normalize();
-
         // 4 UVs are needed for the case, that no colorpalette is available.
         Math::Vec2f uv1, uv2, uv3, uv4;
         
@@ -78,55 +91,109 @@ namespace VCore
         }
         else
         {
+#ifdef VERTEX_COMPACT
+            // Compact vertices only keep uvs in [0, 1]. The color index is restored by round(uv.x * 65535) and the corner by round(uv.y * 3).
+            float color = _color / 65535.f;
+            uv1 = Math::Vec2f(color, 0);
+            uv2 = Math::Vec2f(color, 2 / 3.f);
+            uv3 = Math::Vec2f(color, 1 / 3.f);
+            uv4 = Math::Vec2f(color, 1);
+#else
             uv1 = Math::Vec2f(_color, 0);
             uv2 = Math::Vec2f(_color, 2);
             uv3 = Math::Vec2f(_color, 1);
             uv4 = Math::Vec2f(_color, 3);
+#endif
         }
 
-        int i1, i2, i3, i4;
-        i1 = AddVertex(SVertex(_v1, _normal, uv1), *m_CachedSurface);
-        i2 = AddVertex(SVertex(_v2, _normal, uv2), *m_CachedSurface);
-        i3 = AddVertex(SVertex(_v3, _normal, uv3), *m_CachedSurface);
-        i4 = AddVertex(SVertex(_v4, _normal, uv4), *m_CachedSurface);
+        AddFace(SVertex(_v1, _normal, uv1), SVertex(_v2, _normal, uv2), SVertex(_v3, _normal, uv3), SVertex(_v4, _normal, uv4), _material, _occlusion);
+    }
 
-        // Checks the direction of the face.
-        if(faceNormal == _normal)
+    void CMeshBuilder::AddFace(SVertex _v1, SVertex _v2, SVertex _v3, SVertex _v4, Material _material, const uint8_t *_occlusion)
+    {
+        if(!m_CachedSurface || m_CachedSurface->Surface.FaceMaterial != _material)
+        {
+            m_CachedSurface = &GetSurface(_material);
+            if(m_VertexDeduplication)
+                m_CachedSurface->Index.reserve(100);
+        }
+
+        Math::Vec3f faceNormal = (_v2.Pos - _v1.Pos).cross(_v3.Pos - _v1.Pos).normalize();
+
+        // By default the quad is split between v2 and v3.
+        bool flip = false;
+        if(_occlusion)
         {
-            m_CachedSurface->Surface.Indices.push_back(i1);
-            m_CachedSurface->Surface.Indices.push_back(i2);
-            m_CachedSurface->Surface.Indices.push_back(i3);
+#ifdef VERTEX_AMBIENT_OCCLUSION
+            _v1.AO = _occlusion[0] / 3.f;
+            _v2.AO = _occlusion[1] / 3.f;
+            _v3.AO = _occlusion[2] / 3.f;
+            _v4.AO = _occlusion[3] / 3.f;
+#endif
+            flip = _occlusion[0] + _occlusion[3] > _occlusion[1] + _occlusion[2];
+        }
 
-            m_CachedSurface->Surface.Indices.push_back(i2);
-            m_CachedSurface->Surface.Indices.push_back(i4);
-            m_CachedSurface->Surface.Indices.push_back(i3);
+        int i1, i2, i3, i4;
+        if(m_VertexDeduplication)
+        {
+            i1 = AddVertex(_v1, *m_CachedSurface);
+            i2 = AddVertex(_v2, *m_CachedSurface);
+            i3 = AddVertex(_v3, *m_CachedSurface);
+            i4 = AddVertex(_v4, *m_CachedSurface);
         }
         else
         {
-            m_CachedSurface->Surface.Indices.push_back(i3);
-            m_CachedSurface->Surface.Indices.push_back(i2);
-            m_CachedSurface->Surface.Indices.push_back(i1);
+            auto &surface = m_CachedSurface->Surface;
+            i1 = surface.Size();
+            i2 = i1 + 1;
+            i3 = i1 + 2;
+            i4 = i1 + 3;
+
+            surface.AddVertex(_v1);
+            surface.AddVertex(_v2);
+            surface.AddVertex(_v3);
+            surface.AddVertex(_v4);
+        }
+
+        // The triangles are 1-2-3 / 2-4-3, or 1-2-4 / 1-4-3 if the diagonal is flipped.
+        int order[6] = { i1, i2, i3, i2, i4, i3 };
+        if(flip)
+        {
+            order[2] = i4;
+            order[3] = i1;
+        }
+
+        auto &indices = m_CachedSurface->Surface.Indices;
 
-            m_CachedSurface->Surface.Indices.push_back(i3);
-            m_CachedSurface->Surface.Indices.push_back(i4);
-            m_CachedSurface->Surface.Indices.push_back(i2);
+        // Checks the direction of the face.
+        if(faceNormal == _v1.Normal)
+        {
+            for (int i = 0; i < 6; i++)
+                indices.push_back(order[i]);
+        }
+        else
+        {
+            for (int i = 0; i < 6; i += 3)
+            {
+                indices.push_back(order[i + 2]);
+                indices.push_back(order[i + 1]);
+                indices.push_back(order[i]);
+            }
         }
     }
    
     void CMeshBuilder::AddFace(SVertex v1, SVertex v2, SVertex v3, Material _material)
     {        
-        auto it = m_Surfaces.find((size_t)_material.get());
-        if(it == m_Surfaces.end())
-            it = m_Surfaces.insert({(size_t)_material.get(), SIndexedSurface(_material)}).first;
+        auto &surface = GetSurface(_material);
 
         int i1, i2, i3;
-        i1 = AddVertex(v1, it->second);
-        i2 = AddVertex(v2, it->second);
-        i3 = AddVertex(v3, it->second);
+        i1 = AddVertex(v1, surface);
+        i2 = AddVertex(v2, surface);
+        i3 = AddVertex(v3, surface);
 
-        it->second.Surface.Indices.push_back(i1);
-        it->second.Surface.Indices.push_back(i2);
-        it->second.Surface.Indices.push_back(i3);
+        surface.Surface.Indices.push_back(i1);
+        surface.Surface.Indices.push_back(i2);
+        surface.Surface.Indices.push_back(i3);
     }
 
     Mesh CMeshBuilder::Build()
@@ -140,6 +207,7 @@ namespace VCore
         
         // Clears the cache.
         m_Surfaces.clear();
+        m_CachedSurface = nullptr;
 
         return ret;
     }
@@ -159,22 +227,77 @@ namespace VCore
                 ret->Textures = _Meshes[0]->Textures;
         }
 
-        // for (auto &&m : _Meshes)
-        // {
-        //     for(auto &&surface : m->Surfaces)
-        //     {
-        //         auto it = m_Surfaces.find((size_t)surface.FaceMaterial.get());
-        //         if(it == m_Surfaces.end())
-        //             it = m_Surfaces.insert({(size_t)surface.FaceMaterial.get(), SIndexedSurface(surface.FaceMaterial)}).first;
+        std::vector<Math::Mat4x4> rotations(_Meshes.size());
+        if(_ApplyModelMatrix)
+        {
+            for (size_t i = 0; i < _Meshes.size(); i++)
+            {
+                auto euler = _Meshes[i]->ModelMatrix.GetEuler();
+                rotations[i]
+                    .Rotate(Math::Vec3f(0, 0, 1), euler.z)
+                    .Rotate(Math::Vec3f(1, 0, 0), euler.x)
+                    .Rotate(Math::Vec3f(0, 1, 0), euler.y);
+            }
+        }
+
+        // Assigns each surface to the merged surface with the same material.
+        for (size_t i = 0; i < _Meshes.size(); i++)
+        {
+            for (auto &&surface : _Meshes[i]->Surfaces)
+            {
+                SMergePart part;
+                part.Surface = &surface;
+                part.ModelMatrix = _ApplyModelMatrix ? &_Meshes[i]->ModelMatrix : nullptr;
+                part.Rotation = &rotations[i];
+                part.BorderCount = 0;
+                part.FirstIndex = 0;
+                part.Target = nullptr;
+                GetSurface(surface.FaceMaterial).MergeParts.push_back(std::move(part));
+            }
+        }
+
+        std::vector<SMergePart*> parts;
+        std::vector<SIndexedSurface*> surfaces;
+        for (auto &&surface : m_Surfaces)
+        {
+            surfaces.push_back(&surface.second);
+            for (auto &&part : surface.second.MergeParts)
+                parts.push_back(&part);
+        }
+
+        // The vertices inside of a chunk are already unique, so only the ones near the chunk borders need to be welded.
+        RunParallel(parts.size(), [&](size_t _Idx)
+        {
+            auto &part = *parts[_Idx];
+            part.Remap.resize(part.Surface->Size(), 0);
+            part.BorderCount = 0;
+            if(!m_VertexDeduplication)
+                return;
 
-        //         it->second.Surface.Vertices.reserve(it->second.Surface.Vertices.capacity() + surface.Vertices.size());
-        //         it->second.Surface.Indices.reserve(it->second.Surface.Indices.capacity() + surface.Indices.size());
-        //     }
+            for (int i = 0; i < part.Surface->Size(); i++)
+            {
+                if(IsOnBorder(part.GetVertex(i).Pos))
+                {
+                    part.Remap[i] = -1;
+                    part.BorderCount++;
+                }
+            }
+        });
 
-        // }
+        // Each merged surface is independent of the others.
+        RunParallel(surfaces.size(), [&](size_t _Idx)
+        {
+            WeldParts(*surfaces[_Idx]);
+        });
 
-        for (auto &&m : _Meshes)       
-            MergeIntoThis(m, _ApplyModelMatrix);
+        // Copies the remapped indices of all parts to the positions, which WeldParts has reserved.
+        RunParallel(parts.size(), [&](size_t _Idx)
+        {
+            auto &part = *parts[_Idx];
+            auto &indices = part.Surface->Indices;
+            for (size_t i = 0; i < indices.size(); i++)
+                (*part.Target)[part.FirstIndex + i] = part.Remap[indices[i]];
+        });
 
         ret->Surfaces.clear();
         for (auto &&surface : m_Surfaces)
@@ -182,111 +305,106 @@ namespace VCore
 
         // Clears the cache.
         m_Surfaces.clear();
+        m_CachedSurface = nullptr;
 
         return ret;
     }
 
-    bool CMeshBuilder::IsOnBorder(const Math::Vec3f &_Pos)
+    void CMeshBuilder::WeldParts(SIndexedSurface &_Surface)
     {
-        for (size_t i = 0; i < 3; i++)
+        size_t vertexCount = 0, borderCount = 0;
+        for (auto &&part : _Surface.MergeParts)
         {
-            int pos = _Pos.v[i] - ((int)(_Pos.v[i] / 16.f) * 16);
-
-            // TODO: Should I ever make the chunk size dynamically, than must this be also dynamic.
-            if(pos == 0 || pos == 15)
-                return true;
+            vertexCount += part.Surface->Size();
+            borderCount += part.BorderCount;
         }
 
-        return false;
-    }
+        _Surface.Surface.Reserve(_Surface.Surface.Size() + vertexCount);
+        _Surface.Index.reserve(_Surface.Index.size() + borderCount);
 
-    void CMeshBuilder::GenerateCache(Mesh _MergeInto)
-    {
-        m_Textures = &_MergeInto->Textures;
-
-        for (auto &&surface : _MergeInto->Surfaces)
+        int next = _Surface.Surface.Size();
+        size_t firstIndex = _Surface.Surface.Indices.size();
+        for (auto &&part : _Surface.MergeParts)
         {
-            auto it = m_Surfaces.find((size_t)surface.FaceMaterial.get());
-            if(it == m_Surfaces.end())
-                it = m_Surfaces.insert({(size_t)surface.FaceMaterial.get(), SIndexedSurface(surface.FaceMaterial)}).first;
+            part.FirstIndex = firstIndex;
+            part.Target = &_Surface.Surface.Indices;
+            firstIndex += part.Surface->Indices.size();
 
-            it->second.Surface = std::move(surface);
-            for (auto &&i : it->second.Surface.Indices)
+            for (int i = 0; i < part.Surface->Size(); i++)
             {
-                auto v = it->second.Surface[i];
-                if(IsOnBorder(v.Pos))
-                    it->second.Index.insert({v, i});
-                //     AddVertex(v, it->second);
-                // else
-                //     it->second.Surface.AddVertex(v);
+                if(part.Remap[i] == -1)
+                {
+                    SVertex v = part.GetVertex(i);
+                    auto it = _Surface.Index.find(v);
+                    if(it != _Surface.Index.end())
+                    {
+                        part.Remap[i] = it->second;
+                        continue;
+                    }
+
+                    _Surface.Index.insert({v, next});
+                    _Surface.Surface.AddVertex(v);
+                }
+                else
+                    _Surface.Surface.AddVertex(part.GetVertex(i));
+
+                part.Remap[i] = next++;
             }
-        }       
+        }
+
+        _Surface.Surface.Indices.resize(firstIndex);
     }
 
-    void CMeshBuilder::AddMergeVertex(const SVertex &_Vertex, SIndexedSurface &_Surface, ankerl::unordered_dense::map<SVertex, int, VertexHasher> &_Index)
+    void CMeshBuilder::RunParallel(size_t _Count, const std::function<void(size_t)> &_Fn)
     {
-        int idx;
-        if(IsOnBorder(_Vertex.Pos))
-            idx = AddVertex(_Vertex, _Surface);
-        else
+        if(!m_ThreadPool || _Count < 2)
         {
-            auto it = _Index.find(_Vertex);
-            if(it != _Index.end())
-                idx = it->second;
-            else
-            {
-                idx = _Surface.Surface.Size();
-                _Surface.Surface.AddVertex(_Vertex);
-                _Index.insert({_Vertex, idx});
-            }
+            for (size_t i = 0; i < _Count; i++)
+                _Fn(i);
+
+            return;
         }
 
-        _Surface.Surface.Indices.push_back(idx);
+        std::vector<std::future<void>> futures;
+        futures.reserve(_Count);
+        for (size_t i = 0; i < _Count; i++)
+            futures.push_back(m_ThreadPool->Enqueue(_Fn, i));
+
+        for (auto &&f : futures)
+            m_ThreadPool->Wait(f);
     }
 
-    void CMeshBuilder::MergeIntoThis(Mesh m, bool _ApplyModelMatrix)
+    bool CMeshBuilder::IsOnBorder(const Math::Vec3f &_Pos)
     {
-        Math::Mat4x4 rotation;
-        static ankerl::unordered_dense::map<SVertex, int, VertexHasher> localIndex;
-
-        if(_ApplyModelMatrix)
+        // The cubes of marching cubes reach up to two voxels into the neighbouring chunks, so all vertices within two voxels of a border are welded.
+        for (size_t i = 0; i < 3; i++)
         {
-            auto euler = m->ModelMatrix.GetEuler();
-            rotation
-                .Rotate(Math::Vec3f(0, 0, 1), euler.z)
-                .Rotate(Math::Vec3f(1, 0, 0), euler.x)
-                .Rotate(Math::Vec3f(0, 1, 0), euler.y);
+            float pos = _Pos.v[i] - std::floor(_Pos.v[i] / m_ChunkSize.v[i]) * m_ChunkSize.v[i];
+            if(pos <= 2 || pos >= m_ChunkSize.v[i] - 2)
+                return true;
         }
 
-        for (auto &&surface : m->Surfaces)
-        {
-            auto it = m_Surfaces.find((size_t)surface.FaceMaterial.get());
-            if(it == m_Surfaces.end())
-                it = m_Surfaces.insert({(size_t)surface.FaceMaterial.get(), SIndexedSurface(surface.FaceMaterial)}).first;
+        return false;
+    }
 
-            for (size_t i = 0; i < surface.Indices.size(); i += 3)
-            {
-                SVertex v1 = surface[surface.Indices[i]];
-                SVertex v2 = surface[surface.Indices[i + 1]];
-                SVertex v3 = surface[surface.Indices[i + 2]];
+    void CMeshBuilder::GenerateCache(Mesh _MergeInto)
+    {
+        m_Textures = &_MergeInto->Textures;
 
-                if(_ApplyModelMatrix)
-                {
-                    v1.Pos = m->ModelMatrix * v1.Pos;
-                    v1.Normal = rotation * v1.Normal;
+        for (auto &&surface : _MergeInto->Surfaces)
+        {
+            auto &merged = GetSurface(surface.FaceMaterial);
 
-                    v2.Pos = m->ModelMatrix * v2.Pos;
-                    v2.Normal = rotation * v2.Normal;
+            merged.Surface = std::move(surface);
+            if(!m_VertexDeduplication)
+                continue;
 
-                    v3.Pos = m->ModelMatrix * v3.Pos;
-                    v3.Normal = rotation * v3.Normal;
-                }
-                AddMergeVertex(v1, it->second, localIndex);
-                AddMergeVertex(v2, it->second, localIndex);
-                AddMergeVertex(v3, it->second, localIndex);
+            for (int i = 0; i < merged.Surface.Size(); i++)
+            {
+                auto v = merged.Surface[i];
+                if(IsOnBorder(v.Pos))
+                    merged.Index.insert({v, i});
             }
-        }
-
-        localIndex.clear();
+        }       
     }
 }
@@ -88,6 +88,10 @@ namespace VCore
     {
         if(_Root)
         {
+            // None of the free leafs of this subtree is large enough.
+            if((_Size.x > _Root->Free.x) || (_Size.y > _Root->Free.y))
+                return nullptr;
+
             if(!_Root->Leaf)
             {
                 auto node = FindNode(_Root->Child[0], _Size); 
@@ -114,9 +118,26 @@ namespace VCore
         if(size.x > 0)
             _Root->Child[1] = new SNode(_Root->Position + Math::Vec2ui(_Size.x, 0), size);
 
+        UpdateFreeSpace(_Root);
         return _Root->Position;
     }
 
+    void CTexturePacker::UpdateFreeSpace(SNode *_Node)
+    {
+        for (; _Node; _Node = _Node->Parent)
+        {
+            _Node->Free = Math::Vec2ui();
+            for (size_t i = 0; i < 2; i++)
+            {
+                if(_Node->Child[i])
+                {
+                    _Node->Child[i]->Parent = _Node;
+                    _Node->Free = _Node->Free.max(_Node->Child[i]->Free);
+                }
+            }
+        }
+    }
+
     SNode *CTexturePacker::ResizeCanvas(SNode *_Root, const Math::Vec2ui &_Size)
     {
         bool canGrowDown  = (_Size.x <= _Root->Size.x);
@@ -147,6 +168,7 @@ namespace VCore
         newRoot->Child[0] = _Root;
         newRoot->Child[1] = new SNode(Math::Vec2ui(_Root->Size.x, 0), Math::Vec2ui(_Size.x, m_CanvasSize.y));
         newRoot->Leaf = false;
+        UpdateFreeSpace(newRoot);
 
         return newRoot;
     }
@@ -159,6 +181,7 @@ namespace VCore
         newRoot->Child[1] = _Root;
         newRoot->Child[0] = new SNode(Math::Vec2ui(0, _Root->Size.y), Math::Vec2ui(m_CanvasSize.x, _Size.y));
         newRoot->Leaf = false;
+        UpdateFreeSpace(newRoot);
 
         return newRoot;
     }
@@ -62,16 +62,19 @@ namespace VCore
     
     struct SNode
     {
-        SNode() : Child(), Leaf(true) {}
+        SNode() : Child(), Parent(nullptr), Leaf(true) {}
         SNode(const Math::Vec2ui &_Position, const Math::Vec2ui &_Size) : SNode()
         {
             Position = _Position;
             Size = _Size;
+            Free = _Size;
         }
 
         SNode *Child[2];
+        SNode *Parent;
         Math::Vec2ui Position;
         Math::Vec2ui Size;
+        Math::Vec2ui Free;  //!< Largest width and largest height of all free leafs of this subtree. Both may belong to different leafs.
         bool Leaf;
 
         ~SNode()
@@ -116,6 +119,11 @@ namespace VCore
             Math::Vec2ui SplitNode(SNode *_Root, const Math::Vec2ui &_Size);
             SNode *ResizeCanvas(SNode *_Root, const Math::Vec2ui &_Size);
 
+            /**
+             * @brief Recalculates the free space of _Node and all its parents.
+             */
+            void UpdateFreeSpace(SNode *_Node);
+
             SNode *ResizeCanvasRight(SNode *_Root, const Math::Vec2ui &_Size);
             SNode *ResizeCanvasDown(SNode *_Root, const Math::Vec2ui &_Size);
     };    
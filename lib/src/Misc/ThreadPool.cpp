@@ -0,0 +1,141 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <VCore/Misc/ThreadPool.hpp>
+#include <algorithm>
+
+namespace VCore
+{
+    // Pool and queue of the current worker thread. Null for threads outside of any pool.
+    static thread_local const CThreadPool *t_Pool = nullptr;
+    static thread_local size_t t_Queue = 0;
+
+    CThreadPool::CThreadPool(size_t _ThreadCount) : m_Pending(0), m_NextQueue(0), m_Stop(false)
+    {
+        if(_ThreadCount == 0)
+            _ThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (size_t i = 0; i < _ThreadCount; i++)
+            m_Queues.emplace_back(new SQueue());
+
+        for (size_t i = 0; i < _ThreadCount; i++)
+            m_Workers.emplace_back(&CThreadPool::WorkerMain, this, i);
+    }
+
+    void CThreadPool::Push(Task &&_Task)
+    {
+        // Workers keep their subtasks local, other threads distribute their tasks evenly.
+        size_t idx = (t_Pool == this) ? t_Queue : (m_NextQueue++ % m_Queues.size());
+
+        // Counted before queuing, so that the counter never drops below zero, if another thread takes the task immediately.
+        {
+            std::lock_guard<std::mutex> lock(m_SignalLock);
+            m_Pending++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Queues[idx]->Lock);
+            m_Queues[idx]->Tasks.push_back(std::move(_Task));
+        }
+
+        m_WorkSignal.notify_one();
+        m_DoneSignal.notify_all();
+    }
+
+    bool CThreadPool::TryRun()
+    {
+        Task task;
+        size_t own = (t_Pool == this) ? t_Queue : 0;
+
+        for (size_t i = 0; i < m_Queues.size() && !task; i++)
+        {
+            SQueue &queue = *m_Queues[(own + i) % m_Queues.size()];
+            std::lock_guard<std::mutex> lock(queue.Lock);
+            if(queue.Tasks.empty())
+                continue;
+
+            // The newest task of the own queue is still hot in the cache, stolen tasks are taken from the other end.
+            if(i == 0 && t_Pool == this)
+            {
+                task = std::move(queue.Tasks.back());
+                queue.Tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.Tasks.front());
+                queue.Tasks.pop_front();
+            }
+        }
+
+        if(!task)
+            return false;
+
+        m_Pending--;
+        task();
+
+        // Locking before notifying ensures that no waiting thread misses the signal.
+        {
+            std::lock_guard<std::mutex> lock(m_SignalLock);
+        }
+        m_DoneSignal.notify_all();
+
+        return true;
+    }
+
+    void CThreadPool::WaitForSignal(const std::function<bool()> &_Done)
+    {
+        std::unique_lock<std::mutex> lock(m_SignalLock);
+        m_DoneSignal.wait(lock, [&]() { return m_Pending > 0 || _Done(); });
+    }
+
+    void CThreadPool::WorkerMain(size_t _Queue)
+    {
+        t_Pool = this;
+        t_Queue = _Queue;
+
+        while(true)
+        {
+            if(TryRun())
+                continue;
+
+            std::unique_lock<std::mutex> lock(m_SignalLock);
+            m_WorkSignal.wait(lock, [this]() { return m_Pending > 0 || m_Stop; });
+            if(m_Stop && m_Pending == 0)
+                break;
+        }
+    }
+
+    CThreadPool::~CThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_SignalLock);
+            m_Stop = true;
+        }
+
+        m_WorkSignal.notify_all();
+        for (auto &&w : m_Workers)
+            w.join();
+    }
+}
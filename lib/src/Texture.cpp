@@ -22,6 +22,7 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
 #include <VCore/Meshing/Texture.hpp>
 #include <string.h>
 #include <stb_image_write.h>
@@ -86,6 +87,16 @@ namespace VCore
         }
     }
 
+    void CTexture::AddRawPixels(const uint32_t *_Pixels, const Math::Vec2ui &_Position, const Math::Vec2ui &_Size)
+    {
+        if((_Position.x >= m_Size.x || _Position.y >= m_Size.y) ||
+           ((_Position.x + _Size.x > m_Size.x) || _Position.y + _Size.y > m_Size.y))
+            return;
+
+        for (size_t y = 0; y < _Size.y; y++)
+            std::copy(_Pixels + _Size.x * y, _Pixels + _Size.x * (y + 1), m_Pixels.begin() + _Position.x + m_Size.x * (_Position.y + y));
+    }
+
     uint32_t CTexture::GetPixel(const Math::Vec2ui &_Position)
     {
         if(_Position.x >= m_Size.x || _Position.y >= m_Size.y)
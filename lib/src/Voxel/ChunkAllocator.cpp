@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <VCore/Voxel/ChunkAllocator.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+namespace VCore
+{
+    // Each slab holds at least one block, otherwise as many blocks as fit into 256 KiB.
+    // Scenes may contain many small models, so the slabs are kept small.
+    static const size_t SLAB_SIZE = 256 * 1024;
+
+    //////////////////////////////////////////////////
+    // CBlockPool functions
+    //////////////////////////////////////////////////
+
+    CBlockPool::CBlockPool(size_t _BlockSize) : CBlockPool()
+    {
+        // Every block must be able to hold the free list pointer, and must keep it aligned.
+        m_BlockSize = std::max(_BlockSize, sizeof(SFreeBlock));
+        m_BlockSize = (m_BlockSize + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+        m_BlocksPerSlab = std::max<size_t>(1, SLAB_SIZE / m_BlockSize);
+    }
+
+    void *CBlockPool::alloc()
+    {
+        m_Allocations++;
+        if(m_FreeList)
+        {
+            SFreeBlock *block = m_FreeList;
+            m_FreeList = block->Next;
+            return block;
+        }
+
+        if(m_Offset == m_BlocksPerSlab)
+        {
+            m_Slab++;
+            m_Offset = 0;
+        }
+
+        if(m_Slab == m_Slabs.size())
+            m_Slabs.push_back(new char[m_BlocksPerSlab * m_BlockSize]);
+
+        return m_Slabs[m_Slab] + (m_Offset++) * m_BlockSize;
+    }
+
+    void CBlockPool::free(void *_Block)
+    {
+        if(!_Block)
+            return;
+
+        m_Frees++;
+        SFreeBlock *block = (SFreeBlock*)_Block;
+        block->Next = m_FreeList;
+        m_FreeList = block;
+    }
+
+    void CBlockPool::reset()
+    {
+        m_Slab = 0;
+        m_Offset = 0;
+        m_FreeList = nullptr;
+    }
+
+    CBlockPool::~CBlockPool()
+    {
+        for (auto &&slab : m_Slabs)
+            delete[] slab;
+    }
+
+    //////////////////////////////////////////////////
+    // CChunkAllocator functions
+    //////////////////////////////////////////////////
+
+    CChunkAllocator::CChunkAllocator(const Math::Vec3i &_ChunkSize) : m_VoxelCount(_ChunkSize.x * _ChunkSize.y * _ChunkSize.z), m_RowCount(_ChunkSize.y * _ChunkSize.z * 2), m_PlaneCount(_ChunkSize.x + _ChunkSize.y + _ChunkSize.z),
+        m_Voxels(m_VoxelCount * sizeof(CVoxel)), m_Rows(m_RowCount * sizeof(uint64_t)), m_Planes(m_PlaneCount * sizeof(uint32_t)) {}
+
+    CVoxel *CChunkAllocator::allocVoxels()
+    {
+        CVoxel *voxels = (CVoxel*)m_Voxels.alloc();
+        std::uninitialized_fill_n(voxels, m_VoxelCount, CVoxel());
+        return voxels;
+    }
+
+    void CChunkAllocator::freeVoxels(CVoxel *_Voxels)
+    {
+        m_Voxels.free(_Voxels);
+    }
+
+    uint64_t *CChunkAllocator::allocRows()
+    {
+        uint64_t *rows = (uint64_t*)m_Rows.alloc();
+        memset(rows, 0, m_RowCount * sizeof(uint64_t));
+        return rows;
+    }
+
+    void CChunkAllocator::freeRows(uint64_t *_Rows)
+    {
+        m_Rows.free(_Rows);
+    }
+
+    uint32_t *CChunkAllocator::allocPlanes()
+    {
+        uint32_t *planes = (uint32_t*)m_Planes.alloc();
+        memset(planes, 0, m_PlaneCount * sizeof(uint32_t));
+        return planes;
+    }
+
+    void CChunkAllocator::freePlanes(uint32_t *_Planes)
+    {
+        m_Planes.free(_Planes);
+    }
+
+    void CChunkAllocator::reset()
+    {
+        m_Voxels.reset();
+        m_Rows.reset();
+        m_Planes.reset();
+        m_Sparse.release();
+    }
+}
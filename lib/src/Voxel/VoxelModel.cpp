@@ -22,23 +22,47 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
 #include <map>
+#include <stdexcept>
+#include <VCore/Misc/unordered_dense.h>
 #include <VCore/Voxel/VoxelModel.hpp>
 
 namespace VCore
 {
     void CVoxelModel::SetVoxel(const Math::Vec3i &Pos, int Material, int Color, bool Transparent)
     {      
+        if(Material < 0 || Material > CVoxel::MAX_MATERIAL_INDEX)
+            throw std::out_of_range("Material index out of range!");
+
+        if(Color < 0 || Color > CVoxel::MAX_COLOR_INDEX)
+            throw std::out_of_range("Color index out of range!");
+
         CVoxel Tmp;
         
-        Tmp.Material = Material;
-        Tmp.Color = Color;
+        Tmp.Material = (CVoxel::MaterialIndex)Material;
+        Tmp.Color = (CVoxel::ColorIndex)Color;
         Tmp.Transparent = Transparent;
         Tmp.VisibilityMask = CVoxel::Visibility::VISIBLE;
 
         m_Voxels.insert({Pos, Tmp});
     }
 
+    void CVoxelModel::SetVoxels(const std::vector<std::pair<Math::Vec3i, CVoxel>> &Voxels)
+    {
+        m_Voxels.insert(Voxels);
+    }
+
+    void CVoxelModel::BeginBulkInsert()
+    {
+        m_Voxels.beginBulkInsert();
+    }
+
+    void CVoxelModel::EndBulkInsert()
+    {
+        m_Voxels.endBulkInsert();
+    }
+
     void CVoxelModel::RemoveVoxel(const Math::Vec3i &Pos)
     {
         auto IT = m_Voxels.find(Pos);
@@ -92,6 +116,11 @@ namespace VCore
         return m_Voxels.queryVisible(opaque);
     }
 
+    std::vector<CVoxelModel::VoxelData::ppair> CVoxelModel::QueryVisibleList(bool opaque, std::shared_ptr<CThreadPool> _Pool) const
+    {
+        return m_Voxels.queryVisibleList(opaque, _Pool);
+    }
+
     CVoxelModel::VoxelData::querylist CVoxelModel::QueryDirtyChunks()
     {
         return m_Voxels.queryDirtyChunks();
@@ -106,4 +135,114 @@ namespace VCore
     {
         return m_Voxels.queryChunks(_Frustum);
     }
+
+    VoxelModel CVoxelModel::Downsample(int _Factor) const
+    {
+        struct SCandidate
+        {
+            CVoxel Voxel;
+            int Visible;    //!< Count of visible voxels with this look.
+            int Total;
+        };
+
+        auto addVoxel = [](std::vector<SCandidate> &_Candidates, const CVoxel &_Voxel, int _Visible, int _Total)
+        {
+            auto it = std::find_if(_Candidates.begin(), _Candidates.end(), [&_Voxel](const SCandidate &_Candidate)
+            {
+                return _Candidate.Voxel.Color == _Voxel.Color && _Candidate.Voxel.Material == _Voxel.Material && _Candidate.Voxel.Transparent == _Voxel.Transparent;
+            });
+
+            if(it == _Candidates.end())
+                it = _Candidates.insert(_Candidates.end(), {_Voxel, 0, 0});
+
+            it->Visible += _Visible;
+            it->Total += _Total;
+        };
+
+        // Visible voxels decide the look of the block, the hidden ones only break ties.
+        auto best = [](const std::vector<SCandidate> &_Candidates)
+        {
+            return std::max_element(_Candidates.begin(), _Candidates.end(), [](const SCandidate &_Lhs, const SCandidate &_Rhs)
+            {
+                return _Lhs.Visible < _Rhs.Visible || (_Lhs.Visible == _Rhs.Visible && _Lhs.Total < _Rhs.Total);
+            })->Voxel;
+        };
+
+        auto floorDiv = [_Factor](int _Value) { return (_Value >= 0) ? _Value / _Factor : -((-_Value + _Factor - 1) / _Factor); };
+
+        std::vector<std::pair<Math::Vec3i, CVoxel>> voxels;
+        ankerl::unordered_dense::map<Math::Vec3i, std::vector<SCandidate>, Math::Vec3iHasher> split;     //!< Blocks which are split across several chunks.
+        std::vector<SCandidate> candidates;
+
+        for (auto &&c : m_Voxels.queryChunks())
+        {
+            const CBBox chunkDim(c.TotalBBox.Beg, c.TotalBBox.End - c.TotalBBox.Beg);
+            const Math::Vec3i blockBeg(floorDiv(c.InnerBBox.Beg.x), floorDiv(c.InnerBBox.Beg.y), floorDiv(c.InnerBBox.Beg.z));
+            const Math::Vec3i blockEnd(floorDiv(c.InnerBBox.End.x), floorDiv(c.InnerBBox.End.y), floorDiv(c.InnerBBox.End.z));
+
+            Math::Vec3i block;
+            for (block.z = blockBeg.z; block.z <= blockEnd.z; block.z++)
+            {
+                for (block.y = blockBeg.y; block.y <= blockEnd.y; block.y++)
+                {
+                    for (block.x = blockBeg.x; block.x <= blockEnd.x; block.x++)
+                    {
+                        Math::Vec3i beg = block * _Factor;
+                        Math::Vec3i end = beg + Math::Vec3i(_Factor, _Factor, _Factor);
+                        bool inside = c.TotalBBox.ContainsPoint(beg) && c.TotalBBox.ContainsPoint(end - Math::Vec3i(1, 1, 1));
+
+                        beg = beg.max(c.InnerBBox.Beg);
+                        end = end.min(c.InnerBBox.End + Math::Vec3i(1, 1, 1));
+
+                        candidates.clear();
+                        for (int z = beg.z; z < end.z; z++)
+                        {
+                            for (int y = beg.y; y < end.y; y++)
+                            {
+                                for (int x = beg.x; x < end.x; x++)
+                                {
+                                    Voxel v = c.Chunk->find(Math::Vec3i(x, y, z), chunkDim);
+                                    if(v)
+                                        addVoxel(candidates, *v, v->IsVisible() ? 1 : 0, 1);
+                                }
+                            }
+                        }
+
+                        if(candidates.empty())
+                            continue;
+
+                        if(inside)
+                        {
+                            CVoxel voxel = best(candidates);
+                            voxel.VisibilityMask = CVoxel::Visibility::VISIBLE;
+                            voxels.push_back({block, voxel});
+                        }
+                        else
+                        {
+                            auto &other = split[block];
+                            for (auto &&candidate : candidates)
+                                addVoxel(other, candidate.Voxel, candidate.Visible, candidate.Total);
+                        }
+                    }
+                }
+            }
+        }
+
+        for (auto &&block : split)
+        {
+            CVoxel voxel = best(block.second);
+            voxel.VisibilityMask = CVoxel::Visibility::VISIBLE;
+            voxels.push_back({block.first, voxel});
+        }
+
+        auto ret = std::make_shared<CVoxelModel>();
+        ret->Name = Name;
+        ret->TexturingType = TexturingType;
+        ret->TextureMapping = TextureMapping;
+        ret->Materials = Materials;
+        ret->Textures = Textures;
+        ret->SetVoxels(voxels);
+
+        return ret;
+    }
 }
@@ -24,6 +24,8 @@
 
 #include <VCore/Voxel/VoxelSpace.hpp>
 #include <VCore/Voxel/VoxelModel.hpp>
+#include <VCore/Misc/Bits.hpp>
+#include <VCore/Misc/ThreadPool.hpp>
 
 namespace VCore
 {
@@ -40,10 +42,8 @@ namespace VCore
             it.InitFilter();
         else if(m_Chunks->begin() != m_Chunks->end())
         {
-            Math::Vec3iHasher hasher;
-
             CBBox bbox(it.m_Iterator->first, it.m_Iterator->first + m_ChunkSize);
-            it.m_ChunkMeta = {hasher(it.m_Iterator->first), &it.m_Iterator->second, bbox, it.m_Iterator->second.inner_bbox(it.m_Iterator->first)};
+            it.m_ChunkMeta = {SChunkMeta::MakeUniqueId(it.m_Iterator->first, m_ChunkSize), &it.m_Iterator->second, bbox, it.m_Iterator->second.inner_bbox(it.m_Iterator->first)};
         }
 
         return it;
@@ -63,9 +63,8 @@ namespace VCore
             it.InitFilter();
         else
         {
-            Math::Vec3iHasher hasher;
             CBBox bbox(it.m_Iterator->first, it.m_Iterator->first + m_ChunkSize);
-            it.m_ChunkMeta = {hasher(it.m_Iterator->first), &it.m_Iterator->second, bbox, it.m_Iterator->second.inner_bbox(it.m_Iterator->first)};
+            it.m_ChunkMeta = {SChunkMeta::MakeUniqueId(it.m_Iterator->first, m_ChunkSize), &it.m_Iterator->second, bbox, it.m_Iterator->second.inner_bbox(it.m_Iterator->first)};
         }
         return it;
     }
@@ -123,8 +122,7 @@ namespace VCore
 
         if(filtered)
         {
-            Math::Vec3iHasher hasher;
-            _ChunkMeta = {hasher(_Iterator->first), &_Iterator->second, bbox, _Iterator->second.inner_bbox(_Iterator->first)};
+            _ChunkMeta = {SChunkMeta::MakeUniqueId(_Iterator->first, m_ChunkSize), &_Iterator->second, bbox, _Iterator->second.inner_bbox(_Iterator->first)};
         }
 
         return filtered;
@@ -203,17 +201,89 @@ namespace VCore
         return *this;
     }
 
+    //////////////////////////////////////////////////
+    // CVoxelSpaceAccessor functions
+    //////////////////////////////////////////////////
+
+    const CChunk *CVoxelSpaceAccessor::GetChunk(const Math::Vec3i &_v, CBBox &_ChunkDim)
+    {
+        Math::Vec3i position = m_Space->chunkpos(_v);
+        _ChunkDim = CBBox(position, m_Space->m_ChunkSize);
+
+        if(!m_HasLast || m_LastPosition != position || m_Generation != m_Space->m_Generation)
+        {
+            auto it = m_Space->m_Chunks.find(position);
+            m_LastChunk = (it == m_Space->m_Chunks.end()) ? nullptr : &it->second;
+            m_LastPosition = position;
+            m_Generation = m_Space->m_Generation;
+            m_HasLast = true;
+        }
+
+        return m_LastChunk;
+    }
+
+    Voxel CVoxelSpaceAccessor::find(const Math::Vec3i &_v)
+    {
+        CBBox chunkDim;
+        const CChunk *chunk = GetChunk(_v, chunkDim);
+        if(!chunk)
+            return nullptr;
+
+        return chunk->find(_v, chunkDim);
+    }
+
+    Voxel CVoxelSpaceAccessor::find(const Math::Vec3i &_v, bool _Opaque)
+    {
+        CBBox chunkDim;
+        const CChunk *chunk = GetChunk(_v, chunkDim);
+        if(!chunk)
+            return nullptr;
+
+        return chunk->find(_v, chunkDim, _Opaque);
+    }
+
+    Voxel CVoxelSpaceAccessor::findVisible(const Math::Vec3i &_v)
+    {
+        CBBox chunkDim;
+        const CChunk *chunk = GetChunk(_v, chunkDim);
+        if(!chunk)
+            return nullptr;
+
+        return chunk->findVisible(_v, chunkDim);
+    }
+
+    Voxel CVoxelSpaceAccessor::findVisible(const Math::Vec3i &_v, bool _Opaque)
+    {
+        CBBox chunkDim;
+        const CChunk *chunk = GetChunk(_v, chunkDim);
+        if(!chunk)
+            return nullptr;
+
+        return chunk->findVisible(_v, chunkDim, _Opaque);
+    }
+
     //////////////////////////////////////////////////
     // CVoxelSpace functions
     //////////////////////////////////////////////////
 
-    CVoxelSpace::CVoxelSpace() : m_ChunkSize(16, 16, 16), m_VoxelsCount(0) {}
+    CVoxelSpace::CVoxelSpace() : m_ChunkSize(16, 16, 16), m_ChunkMask(15, 15, 15), m_VoxelsCount(0), m_Generation(0), m_Revision(0), m_Allocator(new CChunkAllocator(m_ChunkSize)), m_BBox(Math::Vec3i(INT32_MAX, INT32_MAX, INT32_MAX), Math::Vec3i()), m_BBoxValid(true), m_BulkInsertDepth(0) {}
     CVoxelSpace::CVoxelSpace(const Math::Vec3i &_ChunkSize) : CVoxelSpace()
     {
-        m_ChunkSize = _ChunkSize;
+        // Rounds each axis up to the next power of two, so that chunk positions can be calculated via masks.
+        for (int i = 0; i < 3; i++)
+        {
+            int size = 1;
+            while(size < _ChunkSize.v[i])
+                size <<= 1;
+
+            m_ChunkSize.v[i] = size;
+        }
+
+        m_ChunkMask = m_ChunkSize - Math::Vec3i(1, 1, 1);
+        m_Allocator.reset(new CChunkAllocator(m_ChunkSize));
     }
 
-    CVoxelSpace::CVoxelSpace(CVoxelSpace &&_Other) 
+    CVoxelSpace::CVoxelSpace(CVoxelSpace &&_Other) : CVoxelSpace()
     {
         *this = std::move(_Other);
     }
@@ -225,10 +295,80 @@ namespace VCore
 
         // Creates a new chunk, if neccessary
         if(it == m_Chunks.end())
-            it = m_Chunks.insert({position, CChunk(m_ChunkSize)}).first;
+        {
+            it = m_Chunks.insert({position, CChunk(m_ChunkSize, m_Allocator.get())}).first;
+            m_Generation++;
+        }
 
-        if(it->second.insert(this, _pair, CBBox(position, m_ChunkSize)))
+        bool created;
+        if(m_BulkInsertDepth)
+        {
+            created = it->second.rawInsert(_pair, CBBox(position, m_ChunkSize));
+            m_BulkChunks.insert(position);
+        }
+        else
+            created = it->second.insert(this, _pair, CBBox(position, m_ChunkSize));
+
+        if(created)
             m_VoxelsCount++;
+
+        m_Revision++;
+        m_BBox.Beg = m_BBox.Beg.min(_pair.first);
+        m_BBox.End = m_BBox.End.max(_pair.first);
+    }
+
+    void CVoxelSpace::insert(const std::vector<pair> &_pairs)
+    {
+        beginBulkInsert();
+        for (auto &&p : _pairs)
+            insert(p);
+        endBulkInsert();
+    }
+
+    void CVoxelSpace::beginBulkInsert()
+    {
+        m_BulkInsertDepth++;
+    }
+
+    void CVoxelSpace::endBulkInsert()
+    {
+        if(m_BulkInsertDepth == 0 || --m_BulkInsertDepth != 0)
+            return;
+
+        const Math::Vec3i chunkEnd = m_ChunkSize - Math::Vec3i(1, 1, 1);
+
+        // Recalculates every touched chunk as a whole.
+        for (auto &&position : m_BulkChunks)
+        {
+            auto it = m_Chunks.find(position);
+            if(it != m_Chunks.end())
+                it->second.updateVisibility(this, CBBox(position, m_ChunkSize), CBBox(Math::Vec3i(), chunkEnd));
+        }
+
+        // Untouched neighbours only need to update the plane, which faces the touched chunk.
+        for (auto &&position : m_BulkChunks)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                for (int dir = -1; dir <= 1; dir += 2)
+                {
+                    Math::Vec3i neighbour = position;
+                    neighbour.v[axis] += dir * m_ChunkSize.v[axis];
+                    if(m_BulkChunks.find(neighbour) != m_BulkChunks.end())
+                        continue;
+
+                    auto it = m_Chunks.find(neighbour);
+                    if(it == m_Chunks.end())
+                        continue;
+
+                    CBBox plane(Math::Vec3i(), chunkEnd);
+                    plane.Beg.v[axis] = plane.End.v[axis] = (dir < 0) ? chunkEnd.v[axis] : 0;
+                    it->second.updateVisibility(this, CBBox(neighbour, m_ChunkSize), plane);
+                }
+            }
+        }
+
+        m_BulkChunks.clear();
     }
 
     CVoxelSpace::iterator CVoxelSpace::erase(const iterator &_it)
@@ -238,35 +378,39 @@ namespace VCore
         if(it == m_Chunks.end())
             return end();
 
-        auto res = it->second.erase(this, _it, CBBox(position, m_ChunkSize));
-        if(res.first)
+        size_t chunkIdx = it - m_Chunks.begin();
+        size_t cursor;
+        if(it->second.erase(this, _it->first, CBBox(position, m_ChunkSize), cursor))
+        {
             m_VoxelsCount--;
+            m_Revision++;
 
-        auto bbox = it->second.inner_bbox(position);
-
-        // Removes the empty chunk.
-        if(bbox.End < bbox.Beg)
-            it = m_Chunks.erase(it);
+            // Only a voxel on the border may shrink the bbox.
+            for (int i = 0; i < 3; i++)
+            {
+                if(_it->first.v[i] == m_BBox.Beg.v[i] || _it->first.v[i] == m_BBox.End.v[i])
+                    m_BBoxValid = false;
+            }
+        }
 
-        if(it != m_Chunks.end())
+        // Removes the empty chunk. The last chunk takes its place, so the search continues with the same index.
+        if(it->second.size() == 0)
         {
-            auto result = res.second;
+            m_Chunks.erase(it);
+            m_Generation++;
+            cursor = 0;
 
-            // Searches for the next voxel inside of any chunk.
-            while (!result.second)
+            // The removed chunk can't be dirty anymore, so its neighbours carry the change to ::expandDirtyChunks.
+            for (int i = 0; i < 27; i++)
             {
-                it++;
-                if(it == m_Chunks.end())
-                    return end();
-
-                result = it->second.next(it->second.inner_bbox(it->first).Beg, CBBox(it->first, m_ChunkSize));
+                Math::Vec3i offset(i % 3 - 1, (i / 3) % 3 - 1, i / 9 - 1);
+                auto neighbour = m_Chunks.find(position + offset * m_ChunkSize);
+                if(neighbour != m_Chunks.end())
+                    neighbour->second.IsDirty = true;
             }
-            
-            if(result.second)
-                return CVoxelSpaceIterator(this, it->second.inner_bbox(it->first), result);
         }
 
-        return end();
+        return next(chunkIdx, cursor);
     }
 
     CVoxelSpace::iterator CVoxelSpace::find(const Math::Vec3i &_v) const
@@ -280,7 +424,7 @@ namespace VCore
         if(!vox)
             return end();
 
-        return CVoxelSpaceIterator(this, it->second.inner_bbox(it->first), {_v, vox});
+        return CVoxelSpaceIterator(this, it - m_Chunks.begin(), CVoxelSpaceIterator::NO_CURSOR, {_v, vox});
     }
 
     CVoxelSpace::iterator CVoxelSpace::find(const Math::Vec3i &_v, bool _Opaque) const
@@ -294,7 +438,7 @@ namespace VCore
         if(!vox)
             return end();
 
-        return CVoxelSpaceIterator(this, it->second.inner_bbox(it->first), {_v, vox});
+        return CVoxelSpaceIterator(this, it - m_Chunks.begin(), CVoxelSpaceIterator::NO_CURSOR, {_v, vox});
     }
 
     CVoxelSpace::iterator CVoxelSpace::findVisible(const Math::Vec3i &_v) const
@@ -308,53 +452,74 @@ namespace VCore
         if(!vox)
             return end();
 
-        return CVoxelSpaceIterator(this, it->second.inner_bbox(it->first), {_v, vox});
+        return CVoxelSpaceIterator(this, it - m_Chunks.begin(), CVoxelSpaceIterator::NO_CURSOR, {_v, vox});
     }
 
     CVoxelSpace::iterator CVoxelSpace::findVisible(const Math::Vec3i &_v, bool _Opaque) const
     {
-        static std::pair<Math::Vec3i, const CChunk *> last(Math::Vec3i(), nullptr);
-
         Math::Vec3i position = chunkpos(_v);
+        auto it = m_Chunks.find(position);
+        if(it == m_Chunks.end())
+            return end();
 
-        if(!(last.first == position && last.second))
-        {
-            auto it = m_Chunks.find(position);
-            if(it == m_Chunks.end())
-                return end();
-
-            last.first = position;
-            last.second = &it->second;
-        }
-
-        CVoxel *vox = last.second->findVisible(_v, CBBox(position, m_ChunkSize), _Opaque);
+        CVoxel *vox = it->second.findVisible(_v, CBBox(position, m_ChunkSize), _Opaque);
         if(!vox)
             return end();
 
-        return CVoxelSpaceIterator(this, last.second->inner_bbox(last.first), {_v, vox});
+        return CVoxelSpaceIterator(this, it - m_Chunks.begin(), CVoxelSpaceIterator::NO_CURSOR, {_v, vox});
     }
 
 
     VectoriMap<Voxel> CVoxelSpace::queryVisible(bool opaque) const
     {
         VectoriMap<Voxel> ret;
-        for (auto &&c : m_Chunks)
+        forEachVisible([&](const Math::Vec3i &_Position, Voxel _Voxel)
         {
-            auto bbox = CBBox(c.first, m_ChunkSize);
-            auto inner = c.second.inner_bbox(bbox.Beg);
-            for (int z = inner.Beg.z; z < inner.End.z; z++)
+            if(_Voxel->Transparent == !opaque)
+                ret.insert({_Position, _Voxel});
+        });
+
+        return ret;
+    }
+
+    std::vector<CVoxelSpace::ppair> CVoxelSpace::queryVisibleList(bool opaque, std::shared_ptr<CThreadPool> _Pool) const
+    {
+        auto collect = [this, opaque](size_t _Beg, size_t _End)
+        {
+            std::vector<ppair> voxels;
+            forEachVisible(_Beg, _End, [&](const Math::Vec3i &_Position, Voxel _Voxel)
             {
-                for (int y = inner.Beg.y; y < inner.End.y; y++)
-                {
-                    for (int x = inner.Beg.x; x < inner.End.x; x++)
-                    {
-                        auto res = c.second.find(Math::Vec3i(x, y, z), bbox);
-                        if(res && res->IsVisible() && res->Transparent == !opaque)
-                            ret.insert({Math::Vec3i(x, y, z), res});
-                    }
-                }
-            }     
+                if(_Voxel->Transparent == !opaque)
+                    voxels.emplace_back(_Position, _Voxel);
+            });
+
+            return voxels;
+        };
+
+        // Small spaces aren't worth the thread overhead.
+        size_t threads = _Pool ? _Pool->GetThreadCount() : 1;
+        if(threads <= 1 || m_Chunks.size() < threads * 4)
+            return collect(0, m_Chunks.size());
+
+        // Each task scans its own chunk range. The results are joined in range order, so the list stays sorted by chunks.
+        size_t chunksPerTask = (m_Chunks.size() + threads - 1) / threads;
+        std::vector<std::future<std::vector<ppair>>> futures;
+        for (size_t beg = 0; beg < m_Chunks.size(); beg += chunksPerTask)
+            futures.push_back(_Pool->Enqueue(collect, beg, std::min(beg + chunksPerTask, m_Chunks.size())));
+
+        std::vector<std::vector<ppair>> results;
+        size_t total = 0;
+        for (auto &&f : futures)
+        {
+            results.push_back(_Pool->Wait(f));
+            total += results.back().size();
         }
+
+        std::vector<ppair> ret;
+        ret.reserve(total);
+        for (auto &&r : results)
+            ret.insert(ret.end(), r.begin(), r.end());
+
         return ret;
     }
 
@@ -368,6 +533,40 @@ namespace VCore
         });
     }
 
+    void CVoxelSpace::expandDirtyChunks(int _Halo)
+    {
+        if(_Halo <= 0)
+            return;
+
+        // Count of chunks the halo reaches along each axis.
+        Math::Vec3i rings;
+        for (int i = 0; i < 3; i++)
+            rings.v[i] = (_Halo + m_ChunkSize.v[i] - 1) / m_ChunkSize.v[i];
+
+        std::vector<Math::Vec3i> dirty;
+        for (auto &&c : m_Chunks)
+        {
+            if(c.second.IsDirty)
+                dirty.push_back(c.first);
+        }
+
+        for (auto &&position : dirty)
+        {
+            for (int x = -rings.x; x <= rings.x; x++)
+            {
+                for (int y = -rings.y; y <= rings.y; y++)
+                {
+                    for (int z = -rings.z; z <= rings.z; z++)
+                    {
+                        auto it = m_Chunks.find(position + Math::Vec3i(x, y, z) * m_ChunkSize);
+                        if(it != m_Chunks.end())
+                            it->second.IsDirty = true;
+                    }
+                }
+            }
+        }
+    }
+
     void CVoxelSpace::markAsProcessed(const SChunkMeta &_Chunk)
     {
         auto it = m_Chunks.find(_Chunk.TotalBBox.Beg);
@@ -389,70 +588,95 @@ namespace VCore
         }, const_cast<CFrustum*>(_Frustum));
     }
 
-    CVoxelSpace::iterator CVoxelSpace::next(const Math::Vec3i &_FromPosition) const
+    CVoxelSpace::iterator CVoxelSpace::next(size_t _Chunk, size_t _Cursor) const
     {
-        Math::Vec3i position = chunkpos(_FromPosition);
-        auto it = m_Chunks.find(position);
-        if(it == m_Chunks.end())
-            return end();
-
-        auto res = it->second.next(_FromPosition, CBBox(position, m_ChunkSize));
-        
-        // Searches for the next voxel inside of any chunk.
-        while (!res.second)
+        auto &chunks = m_Chunks.values();
+        for (; _Chunk < chunks.size(); _Chunk++, _Cursor = 0)
         {
-            it++;
-            if(it == m_Chunks.end())
-                return end();
-
-            res = it->second.next(it->second.inner_bbox(it->first).Beg, CBBox(it->first, m_ChunkSize));
+            auto res = chunks[_Chunk].second.next(_Cursor, CBBox(chunks[_Chunk].first, m_ChunkSize));
+            if(res.second)
+                return CVoxelSpaceIterator(this, _Chunk, _Cursor, res);
         }
 
-        if(res.second)
-            return CVoxelSpaceIterator(this, it->second.inner_bbox(it->first), res);
-
         return end();
     }
 
     CVoxelSpace::iterator CVoxelSpace::begin()
     {
-        if(m_Chunks.empty())
-            return end();
-
-        auto it = m_Chunks.begin();
-        auto bbox = it->second.inner_bbox(it->first);
-        return CVoxelSpaceIterator(this, bbox, it->second.next(bbox.Beg, CBBox(it->first, m_ChunkSize)));
+        return next(0, 0);
     }
 
     CVoxelSpace::iterator CVoxelSpace::end() const
     {
-        return CVoxelSpaceIterator(this, CBBox(), {Math::Vec3i(), nullptr});
+        return CVoxelSpaceIterator(this, 0, 0, {Math::Vec3i(), nullptr});
     }
 
     CBBox CVoxelSpace::calculateBBox() const
     {
-        CBBox bbox(Math::Vec3i(INT32_MAX, INT32_MAX, INT32_MAX), Math::Vec3i());
-        for (auto &&c : m_Chunks)
+        std::lock_guard<std::mutex> lock(m_BBoxLock);
+        if(!m_BBoxValid)
         {
-            auto innerBBox = c.second.inner_bbox(c.first);
-            bbox.Beg = innerBBox.Beg.min(bbox.Beg);
-            bbox.End = innerBBox.End.max(bbox.End);
+            CBBox bbox(Math::Vec3i(INT32_MAX, INT32_MAX, INT32_MAX), Math::Vec3i());
+            for (auto &&c : m_Chunks)
+            {
+                auto innerBBox = c.second.inner_bbox(c.first);
+                bbox.Beg = innerBBox.Beg.min(bbox.Beg);
+                bbox.End = innerBBox.End.max(bbox.End);
+            }
+
+            m_BBox = bbox;
+            m_BBoxValid = true;
         }
 
-        return bbox;
+        return m_BBox;
+    }
+
+    size_t CVoxelSpace::memoryUsage() const
+    {
+        size_t bytes = m_Chunks.bucket_count() * sizeof(decltype(m_Chunks)::bucket_type) + m_Chunks.values().capacity() * sizeof(decltype(m_Chunks)::value_type);
+        for (auto &&c : m_Chunks)
+            bytes += c.second.memoryUsage(m_ChunkSize) - sizeof(CChunk);
+
+        return bytes;
     }
 
     void CVoxelSpace::clear()
     {
+        // The allocator takes all blocks back at once, so the chunks don't return them one by one.
+        for (auto &&c : m_Chunks)
+            c.second.detach();
+
         m_Chunks.clear();
+        m_Allocator->reset();
+        m_Generation++;
+        m_Revision++;
+        m_VoxelsCount = 0;
+        m_BBox = CBBox(Math::Vec3i(INT32_MAX, INT32_MAX, INT32_MAX), Math::Vec3i());
+        m_BBoxValid = true;
+        m_BulkChunks.clear();
     }
 
     CVoxelSpace &CVoxelSpace::operator=(CVoxelSpace &&_Other)
     {
+        // The chunks keep a pointer to their allocator, so the allocator moves along with them.
+        clear();
         m_ChunkSize = _Other.m_ChunkSize;
+        m_ChunkMask = _Other.m_ChunkMask;
         m_VoxelsCount = _Other.m_VoxelsCount;
         m_Chunks = std::move(_Other.m_Chunks);
-
+        m_Allocator = std::move(_Other.m_Allocator);
+        _Other.m_Allocator.reset(new CChunkAllocator(_Other.m_ChunkSize));
+        m_Generation = std::max(m_Generation, _Other.m_Generation) + 1;
+        _Other.m_Generation++;
+        m_Revision = std::max(m_Revision, _Other.m_Revision) + 1;
+        _Other.m_Revision++;
+        m_BBox = _Other.m_BBox;
+        m_BBoxValid = _Other.m_BBoxValid;
+        m_BulkInsertDepth = _Other.m_BulkInsertDepth;
+        m_BulkChunks = std::move(_Other.m_BulkChunks);
+
+        _Other.m_BBoxValid = false;
+        _Other.m_BulkInsertDepth = 0;
         return *this;
     }
 
@@ -468,22 +692,30 @@ namespace VCore
 
     Math::Vec3i CVoxelSpace::chunkpos(const Math::Vec3i &_Position) const
     {
-        // const static uint32_t mask = 0xFFFFFFF0;
-        // Math::Vec3i(_Position.x & mask, _Position.y & mask, _Position.z & mask);
-
-        return Math::floor(Math::Vec3f(_Position) / m_ChunkSize) * m_ChunkSize;
+        // Clearing the lower bits rounds towards negative infinity, also for negative positions.
+        return Math::Vec3i(_Position.x & ~m_ChunkMask.x, _Position.y & ~m_ChunkMask.y, _Position.z & ~m_ChunkMask.z);
     }
 
     //////////////////////////////////////////////////
     // CVoxelSpace::CChunk functions
     //////////////////////////////////////////////////
 
-    CChunk::CChunk(const Math::Vec3i &_ChunkSize) : IsDirty(false), m_InnerBBox(Math::Vec3i(INT32_MAX, INT32_MAX, INT32_MAX), Math::Vec3i())
+    // A chunk switches to the dense storage, if more than 1 / DENSE_FILL_RATIO voxels are set and back to the sparse storage below 1 / SPARSE_FILL_RATIO.
+    // The gap between both avoids switching back and forth on every insert and erase.
+    static const size_t DENSE_FILL_RATIO = 4;
+    static const size_t SPARSE_FILL_RATIO = 16;
+
+    CChunk::CChunk(const Math::Vec3i &_ChunkSize, CChunkAllocator *_Allocator) : IsDirty(false), m_Allocator(_Allocator), m_Data(nullptr), m_Sparse(_Allocator->sparseResource()), m_VoxelCount(0), m_InnerBBox(Math::Vec3i(INT32_MAX, INT32_MAX, INT32_MAX), Math::Vec3i()), m_PlaneCounts(_Allocator->allocPlanes()), m_OpaqueRows(nullptr), m_TransparentRows(nullptr)
     {
-        m_Data = new CVoxel[_ChunkSize.x * _ChunkSize.y * _ChunkSize.z];   
+        // A row must fit into a single 64 bit word.
+        if(_ChunkSize.x <= 64)
+        {
+            m_OpaqueRows = m_Allocator->allocRows();
+            m_TransparentRows = m_OpaqueRows + _ChunkSize.y * _ChunkSize.z;
+        }
     }
 
-    CChunk::CChunk(CChunk &&_Other) : m_Data(nullptr)
+    CChunk::CChunk(CChunk &&_Other) : m_Allocator(nullptr), m_Data(nullptr), m_Sparse(_Other.m_Sparse.get_allocator()), m_VoxelCount(0), m_PlaneCounts(nullptr), m_OpaqueRows(nullptr), m_TransparentRows(nullptr)
     {
         *this = std::move(_Other);
     }
@@ -530,7 +762,7 @@ namespace VCore
     CVoxel *CChunk::GetBlock(CVoxelSpace *_Space, const CBBox &_ChunkDim, const Math::Vec3i &_v)
     {
         if((_v.x >= 0 && _v.y >= 0 && _v.z >= 0) && (_v.x < _ChunkDim.End.x && _v.y < _ChunkDim.End.y && _v.z < _ChunkDim.End.z))
-            return &m_Data[_v.x + _ChunkDim.End.x * _v.y + _ChunkDim.End.x * _ChunkDim.End.y * _v.z];
+            return At(_v.x + _ChunkDim.End.x * _v.y + _ChunkDim.End.x * _ChunkDim.End.y * _v.z);
         else
         {
             auto globalPos =  _ChunkDim.Beg + _v;
@@ -549,14 +781,20 @@ namespace VCore
     bool CChunk::insert(CVoxelSpace *_Space, const pair &_pair, const CBBox &_ChunkDim)
     {
         bool result = true;
-        Math::Vec3i relPos = (_pair.first - _ChunkDim.Beg).abs();
-        CVoxel &voxel = m_Data[relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z]; //= _pair.second;
+        Math::Vec3i relPos = _pair.first - _ChunkDim.Beg;
+        CVoxel &voxel = Emplace(relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z, _ChunkDim.End);
         if(voxel.IsInstantiated())
             result = false;
+        else
+        {
+            m_VoxelCount++;
+            CountPlanes(relPos, _ChunkDim.End, 1);
+        }
 
         voxel.Color = _pair.second.Color;
         voxel.Material = _pair.second.Material;
         voxel.Transparent = _pair.second.Transparent;
+        SetRowBit(relPos, _ChunkDim.End, voxel.Transparent);
 
         if(!voxel.IsVisible())
             voxel.VisibilityMask = CVoxel::Visibility::VISIBLE;
@@ -577,35 +815,299 @@ namespace VCore
         return result;
     }
 
-    bool CChunk::HasVoxelOnPlane(int _Axis, const Math::Vec3i &_Pos, const Math::Vec3i &_ChunkSize)
+    bool CChunk::rawInsert(const pair &_pair, const CBBox &_ChunkDim)
     {
-        Math::Vec3i pos = _Pos;
-        int heightAxis = (_Axis + 1) % 3; // 1 = 1 = y, 2 = 2 = z, 3 = 0 = x
-        int widthAxis = (_Axis + 2) % 3; // 2 = 2 = z, 3 = 0 = x, 4 = 1 = y
+        Math::Vec3i relPos = _pair.first - _ChunkDim.Beg;
+        CVoxel &voxel = Emplace(relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z, _ChunkDim.End);
+        bool result = !voxel.IsInstantiated();
+        if(result)
+        {
+            m_VoxelCount++;
+            CountPlanes(relPos, _ChunkDim.End, 1);
+        }
+
+        voxel.Color = _pair.second.Color;
+        voxel.Material = _pair.second.Material;
+        voxel.Transparent = _pair.second.Transparent;
+        voxel.VisibilityMask = CVoxel::Visibility::VISIBLE;
+        SetRowBit(relPos, _ChunkDim.End, voxel.Transparent);
 
-        pos.v[widthAxis] = m_InnerBBox.Beg.v[widthAxis];
-        for (; pos.v[widthAxis] <= m_InnerBBox.End.v[widthAxis]; pos.v[widthAxis]++)
+        m_InnerBBox.Beg = m_InnerBBox.Beg.min(relPos);
+        m_InnerBBox.End = m_InnerBBox.End.max(relPos);
+        IsDirty = true;
+
+        return result;
+    }
+
+    void CChunk::updateVisibility(CVoxelSpace *_Space, const CBBox &_ChunkDim, const CBBox &_Region)
+    {
+        // Same order as the bits of CVoxel::Visibility.
+        const Math::Vec3i directions[6] = {
+            Math::Vec3i(0, 1, 0), Math::Vec3i(0, -1, 0),
+            Math::Vec3i(-1, 0, 0), Math::Vec3i(1, 0, 0),
+            Math::Vec3i(0, 0, 1), Math::Vec3i(0, 0, -1)
+        };
+
+        const Math::Vec3i &size = _ChunkDim.End;
+        const CChunk *neighbours[6];
+        for (int i = 0; i < 6; i++)
+            neighbours[i] = _Space->GetChunk(_ChunkDim.Beg + directions[i] * size);
+
+        Math::Vec3i beg = _Region.Beg.max(m_InnerBBox.Beg);
+        Math::Vec3i end = _Region.End.min(m_InnerBBox.End);
+        bool changed = false;
+
+        if(m_OpaqueRows)
+            changed = UpdateRowVisibility(size, neighbours, beg, end);
+        else
         {
-            pos.v[heightAxis] = m_InnerBBox.Beg.v[heightAxis];
-            for (; pos.v[heightAxis] <= m_InnerBBox.End.v[heightAxis]; pos.v[heightAxis]++)
+            for (int z = beg.z; z <= end.z; z++)
             {
-                if(m_Data[pos.x + _ChunkSize.x * pos.y + _ChunkSize.x * _ChunkSize.y * pos.z].IsInstantiated())
-                    return true;
+                for (int y = beg.y; y <= end.y; y++)
+                {
+                    for (int x = beg.x; x <= end.x; x++)
+                    {
+                        CVoxel *voxel = At(x + size.x * y + size.x * size.y * z);
+                        if(!voxel || !voxel->IsInstantiated())
+                            continue;
+
+                        uint8_t mask = CVoxel::Visibility::INVISIBLE;
+                        for (int i = 0; i < 6; i++)
+                        {
+                            Math::Vec3i pos = Math::Vec3i(x, y, z) + directions[i];
+                            const CVoxel *other = nullptr;
+
+                            if((pos.x >= 0 && pos.y >= 0 && pos.z >= 0) && (pos.x < size.x && pos.y < size.y && pos.z < size.z))
+                                other = At(pos.x + size.x * pos.y + size.x * size.y * pos.z);
+                            else if(neighbours[i])
+                            {
+                                pos = Math::Vec3i((pos.x + size.x) % size.x, (pos.y + size.y) % size.y, (pos.z + size.z) % size.z);
+                                other = neighbours[i]->At(pos.x + size.x * pos.y + size.x * size.y * pos.z);
+                            }
+
+                            // Same rules as CheckAndUpdateVisibility.
+                            if(!other || !other->IsInstantiated() || (other->Transparent && !voxel->Transparent))
+                                mask |= (1 << i);
+                        }
+
+                        if(voxel->VisibilityMask != mask)
+                        {
+                            voxel->VisibilityMask = (CVoxel::Visibility)mask;
+                            changed = true;
+                        }
+                    }
+                }
             }
         }
-        
-        return false;
+
+        if(changed)
+            IsDirty = true;
+    }
+
+    bool CChunk::UpdateRowVisibility(const Math::Vec3i &_ChunkSize, const CChunk *const _Neighbours[6], const Math::Vec3i &_Beg, const Math::Vec3i &_End)
+    {
+        bool changed = false;
+        const uint64_t regionMask = BitRange(_Beg.x, _End.x);
+        const int lastX = _ChunkSize.x - 1;
+
+        for (int z = _Beg.z; z <= _End.z; z++)
+        {
+            for (int y = _Beg.y; y <= _End.y; y++)
+            {
+                uint64_t occupied = occupancy(y, z, _ChunkSize);
+                uint64_t todo = occupied & regionMask;
+                if(!todo)
+                    continue;
+
+                uint64_t opaqueRow = opaque(y, z, _ChunkSize);
+                uint64_t otherOccupied[6], otherTransparent[6];
+
+                // Neighbouring rows in the same order as the bits of CVoxel::Visibility.
+                auto fetchRow = [&](int _Idx, const CChunk *_Chunk, int _Y, int _Z)
+                {
+                    otherOccupied[_Idx] = _Chunk ? _Chunk->occupancy(_Y, _Z, _ChunkSize) : 0;
+                    otherTransparent[_Idx] = _Chunk ? _Chunk->transparent(_Y, _Z, _ChunkSize) : 0;
+                };
+
+                if(y + 1 < _ChunkSize.y) fetchRow(0, this, y + 1, z); else fetchRow(0, _Neighbours[0], 0, z);
+                if(y > 0) fetchRow(1, this, y - 1, z); else fetchRow(1, _Neighbours[1], _ChunkSize.y - 1, z);
+                if(z + 1 < _ChunkSize.z) fetchRow(4, this, y, z + 1); else fetchRow(4, _Neighbours[4], y, 0);
+                if(z > 0) fetchRow(5, this, y, z - 1); else fetchRow(5, _Neighbours[5], y, _ChunkSize.z - 1);
+
+                // Left and right neighbours are the same row shifted by one, the outermost bit comes from the neighbour chunk.
+                fetchRow(2, _Neighbours[2], y, z);
+                otherOccupied[2] = (occupied << 1) | ((otherOccupied[2] >> lastX) & 1);
+                otherTransparent[2] = (transparent(y, z, _ChunkSize) << 1) | ((otherTransparent[2] >> lastX) & 1);
+
+                fetchRow(3, _Neighbours[3], y, z);
+                otherOccupied[3] = (occupied >> 1) | ((otherOccupied[3] & 1) << lastX);
+                otherTransparent[3] = (transparent(y, z, _ChunkSize) >> 1) | ((otherTransparent[3] & 1) << lastX);
+
+                // Same rules as CheckAndUpdateVisibility. A face is visible if there is no neighbour or an opaque voxel touches a transparent one.
+                uint64_t faces[6];
+                for (int i = 0; i < 6; i++)
+                    faces[i] = ~otherOccupied[i] | (otherTransparent[i] & opaqueRow);
+
+                size_t rowIdx = _ChunkSize.x * y + _ChunkSize.x * _ChunkSize.y * z;
+                while(todo)
+                {
+                    int x = CountTrailingZeros(todo);
+                    todo &= todo - 1;
+
+                    uint8_t mask = CVoxel::Visibility::INVISIBLE;
+                    for (int i = 0; i < 6; i++)
+                        mask |= ((faces[i] >> x) & 1) << i;
+
+                    CVoxel *voxel = At(rowIdx + x);
+                    if(voxel->VisibilityMask != mask)
+                    {
+                        voxel->VisibilityMask = (CVoxel::Visibility)mask;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        return changed;
+    }
+
+    void CChunk::SetRowBit(const Math::Vec3i &_Pos, const Math::Vec3i &_ChunkSize, bool _Transparent)
+    {
+        if(!m_OpaqueRows)
+            return;
+
+        size_t idx = _Pos.y + _ChunkSize.y * _Pos.z;
+        uint64_t bit = 1ull << _Pos.x;
+        m_OpaqueRows[idx] = _Transparent ? (m_OpaqueRows[idx] & ~bit) : (m_OpaqueRows[idx] | bit);
+        m_TransparentRows[idx] = _Transparent ? (m_TransparentRows[idx] | bit) : (m_TransparentRows[idx] & ~bit);
     }
 
-    std::pair<bool, CVoxelSpace::ppair> CChunk::erase(CVoxelSpace *_Space, const iterator &_it, const CBBox &_ChunkDim)
+    void CChunk::ClearRowBit(const Math::Vec3i &_Pos, const Math::Vec3i &_ChunkSize)
+    {
+        if(!m_OpaqueRows)
+            return;
+
+        size_t idx = _Pos.y + _ChunkSize.y * _Pos.z;
+        uint64_t bit = 1ull << _Pos.x;
+        m_OpaqueRows[idx] &= ~bit;
+        m_TransparentRows[idx] &= ~bit;
+    }
+
+    CVoxel *CChunk::At(size_t _Idx) const
+    {
+        if(m_Data)
+            return &m_Data[_Idx];
+
+        auto it = m_Sparse.find((uint32_t)_Idx);
+        if(it == m_Sparse.end())
+            return nullptr;
+
+        // Voxels are handed out mutable, same as the dense storage.
+        return const_cast<CVoxel*>(&it->second);
+    }
+
+    CVoxel &CChunk::Emplace(size_t _Idx, const Math::Vec3i &_ChunkSize)
+    {
+        if(!m_Data && (m_VoxelCount + 1) * DENSE_FILL_RATIO > (size_t)(_ChunkSize.x * _ChunkSize.y * _ChunkSize.z))
+            MakeDense();
+
+        if(m_Data)
+            return m_Data[_Idx];
+
+        return m_Sparse[(uint32_t)_Idx];
+    }
+
+    void CChunk::Remove(size_t _Idx, const Math::Vec3i &_ChunkSize)
+    {
+        m_VoxelCount--;
+        if(m_Data)
+        {
+            m_Data[_Idx] = CVoxel();
+            if(m_VoxelCount * SPARSE_FILL_RATIO < (size_t)(_ChunkSize.x * _ChunkSize.y * _ChunkSize.z))
+                MakeSparse(_ChunkSize);
+        }
+        else
+            m_Sparse.erase((uint32_t)_Idx);
+    }
+
+    void CChunk::MakeDense()
+    {
+        m_Data = m_Allocator->allocVoxels();
+        for (auto &&v : m_Sparse)
+            m_Data[v.first] = v.second;
+
+        m_Sparse = SparseMap(m_Allocator->sparseResource());
+    }
+
+    void CChunk::MakeSparse(const Math::Vec3i &_ChunkSize)
+    {
+        SparseMap sparse(m_Allocator->sparseResource());
+        sparse.reserve(m_VoxelCount);
+
+        size_t total = _ChunkSize.x * _ChunkSize.y * _ChunkSize.z;
+        for (size_t i = 0; i < total; i++)
+        {
+            if(m_Data[i].IsInstantiated())
+                sparse.emplace((uint32_t)i, m_Data[i]);
+        }
+
+        m_Allocator->freeVoxels(m_Data);
+        m_Data = nullptr;
+        m_Sparse = std::move(sparse);
+    }
+
+    size_t CChunk::memoryUsage(const Math::Vec3i &_ChunkSize) const
+    {
+        size_t bytes = sizeof(CChunk);
+        if(m_Data)
+            bytes += _ChunkSize.x * _ChunkSize.y * _ChunkSize.z * sizeof(CVoxel);
+        else
+            bytes += m_Sparse.values().capacity() * sizeof(SparseMap::value_type) + m_Sparse.bucket_count() * sizeof(SparseMap::bucket_type);
+
+        if(m_OpaqueRows)
+            bytes += _ChunkSize.y * _ChunkSize.z * 2 * sizeof(uint64_t);
+
+        bytes += (_ChunkSize.x + _ChunkSize.y + _ChunkSize.z) * sizeof(uint32_t);
+
+        return bytes;
+    }
+
+    void CChunk::CountPlanes(const Math::Vec3i &_Pos, const Math::Vec3i &_ChunkSize, int _Delta)
+    {
+        uint32_t *counts = m_PlaneCounts;
+        for (int i = 0; i < 3; i++)
+        {
+            counts[_Pos.v[i]] += _Delta;
+            counts += _ChunkSize.v[i];
+        }
+    }
+
+    bool CChunk::erase(CVoxelSpace *_Space, const Math::Vec3i &_v, const CBBox &_ChunkDim, size_t &_Cursor)
     {
         bool result = true;
-        Math::Vec3i relPos = (_it->first - _ChunkDim.Beg).abs();
-        // m_Data[relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z] = CVoxel();
-        CVoxel &voxel = m_Data[relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z];
-        if(voxel.IsInstantiated())
+        Math::Vec3i relPos = _v - _ChunkDim.Beg;
+        size_t idx = relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z;
+        CVoxel *stored = At(idx);
+        if(stored && stored->IsInstantiated())
         {
-            voxel = CVoxel();
+            bool wasDense = isDense();
+            size_t entry = wasDense ? 0 : (size_t)(m_Sparse.find((uint32_t)idx) - m_Sparse.begin());
+
+            // The storage slot may be gone after removing, so the neighbours are updated against an empty stand-in.
+            CVoxel voxel;
+            Remove(idx, _ChunkDim.End);
+
+            if(m_Data)
+                _Cursor = idx + 1;
+            else if(wasDense)
+            {
+                // The sparse entries were created in index order, so the cursor is the count of entries before the removed voxel.
+                auto &values = m_Sparse.values();
+                _Cursor = std::lower_bound(values.begin(), values.end(), (uint32_t)idx, [](const SparseMap::value_type &_Entry, uint32_t _Idx) { return _Entry.first < _Idx; }) - values.begin();
+            }
+            else
+                _Cursor = entry;    // The last entry has been moved into the freed slot and still needs to be visited.
+            ClearRowBit(relPos, _ChunkDim.End);
             IsDirty = true;
 
             CheckAndUpdateVisibility(_Space, _ChunkDim, &voxel, relPos + Math::Vec3i::UP, ~CVoxel::Visibility::UP, ~CVoxel::Visibility::DOWN);
@@ -617,76 +1119,127 @@ namespace VCore
             CheckAndUpdateVisibility(_Space, _ChunkDim, &voxel, relPos + Math::Vec3i::FRONT, ~CVoxel::Visibility::FORWARD, ~CVoxel::Visibility::BACKWARD);
             CheckAndUpdateVisibility(_Space, _ChunkDim, &voxel, relPos + Math::Vec3i::BACK, ~CVoxel::Visibility::BACKWARD, ~CVoxel::Visibility::FORWARD);
             
-            // Checks if the bbox must be resized
-            for (size_t i = 0; i < 3; i++)
+            // Shrinks the bbox until each side touches a plane with at least one voxel. An empty chunk is removed by the voxel space anyway.
+            CountPlanes(relPos, _ChunkDim.End, -1);
+            const uint32_t *counts = m_PlaneCounts;
+            for (int i = 0; i < 3 && m_VoxelCount; i++)
             {
-                if((relPos.v[i] == m_InnerBBox.End.v[i]) && !HasVoxelOnPlane(i, relPos, _ChunkDim.End))
-                    m_InnerBBox.End.v[i] -= 1;
-                else if((relPos.v[i] == m_InnerBBox.Beg.v[i]) && !HasVoxelOnPlane(i, relPos, _ChunkDim.End))
-                    m_InnerBBox.Beg.v[i] += 1;
+                while(!counts[m_InnerBBox.End.v[i]])
+                    m_InnerBBox.End.v[i]--;
+
+                while(!counts[m_InnerBBox.Beg.v[i]])
+                    m_InnerBBox.Beg.v[i]++;
+
+                counts += _ChunkDim.End.v[i];
             }
         }
         else
+        {
             result = false;
+            _Cursor = cursorAfter(_v, _ChunkDim);
+        }
         
-        return {result, next(_it->first, _ChunkDim)};
+        return result;
     }
 
-    CVoxelSpace::ppair CChunk::next(const Math::Vec3i &_Position, const CBBox &_ChunkDim) const
+    CVoxelSpace::ppair CChunk::next(size_t &_Cursor, const CBBox &_ChunkDim) const
     {
-        Math::Vec3i relPos = (_Position - _ChunkDim.Beg).abs();
-        for (int z = relPos.z; z < m_InnerBBox.End.z; z++)
+        const Math::Vec3i &size = _ChunkDim.End;
+        if(!m_Data)
         {
-            for (int y = relPos.y; y < m_InnerBBox.End.y; y++)
+            auto &values = m_Sparse.values();
+            while(_Cursor < values.size())
             {
-                for (int x = relPos.x; x < m_InnerBBox.End.x; x++)
+                auto &entry = values[_Cursor++];
+                if(entry.second.IsVisible())
+                    return {_ChunkDim.Beg + Position(entry.first, size), const_cast<CVoxel*>(&entry.second)};
+            }
+
+            return {Math::Vec3i(), nullptr};
+        }
+
+        if(_Cursor >= (size_t)(size.x * size.y * size.z))
+            return {Math::Vec3i(), nullptr};
+
+        // Continues inside the row of the cursor, all following rows start at the inner bbox.
+        Math::Vec3i pos = Position(_Cursor, size);
+
+        for (int z = std::max(pos.z, m_InnerBBox.Beg.z); z <= m_InnerBBox.End.z; z++)
+        {
+            int y = (z == pos.z) ? std::max(pos.y, m_InnerBBox.Beg.y) : m_InnerBBox.Beg.y;
+            for (; y <= m_InnerBBox.End.y; y++)
+            {
+                int x = (z == pos.z && y == pos.y) ? std::max(pos.x, m_InnerBBox.Beg.x) : m_InnerBBox.Beg.x;
+                if(m_OpaqueRows && !(occupancy(y, z, size) & BitRange(x, m_InnerBBox.End.x)))
+                    continue;
+
+                size_t row = size.x * y + size.x * size.y * z;
+                for (; x <= m_InnerBBox.End.x; x++)
                 {
-                    CVoxel &vox = m_Data[x + _ChunkDim.End.x * y + _ChunkDim.End.x * _ChunkDim.End.y * z];
-                    if(vox.IsVisible())
-                        return {_ChunkDim.Beg + Math::Vec3i(x, y, z), &vox};
+                    CVoxel *vox = m_Data + row + x;
+                    if(vox->IsVisible())
+                    {
+                        _Cursor = row + x + 1;
+                        return {_ChunkDim.Beg + Math::Vec3i(x, y, z), vox};
+                    }
                 }
             }
         }
-        
+
+        _Cursor = size.x * size.y * size.z;
         return {Math::Vec3i(), nullptr};
     }
 
+    size_t CChunk::cursorAfter(const Math::Vec3i &_v, const CBBox &_ChunkDim) const
+    {
+        Math::Vec3i relPos = _v - _ChunkDim.Beg;
+        size_t idx = relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z;
+        if(m_Data)
+            return idx + 1;
+
+        auto it = m_Sparse.find((uint32_t)idx);
+        if(it == m_Sparse.end())
+            return m_Sparse.size();
+
+        return (it - m_Sparse.begin()) + 1;
+    }
+
     Voxel CChunk::find(const Math::Vec3i &_v, const CBBox &_ChunkDim) const
     {
-        Math::Vec3i relPos = (_v - _ChunkDim.Beg).abs();
-        CVoxel &vox = m_Data[relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z];
-        if(vox.IsInstantiated())
-            return &vox;
+        Math::Vec3i relPos = _v - _ChunkDim.Beg;
+        CVoxel *vox = At(relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z);
+        if(vox && vox->IsInstantiated())
+            return vox;
 
         return nullptr;
     }
 
     Voxel CChunk::find(const Math::Vec3i &_v, const CBBox &_ChunkDim, bool _Opaque) const
     {
-        Math::Vec3i relPos = (_v - _ChunkDim.Beg).abs();
-        CVoxel &vox = m_Data[relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z];
-        if(vox.IsInstantiated() && (vox.Transparent != _Opaque))
-            return &vox;
+        Math::Vec3i relPos = _v - _ChunkDim.Beg;
+        CVoxel *vox = At(relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z);
+        if(vox && vox->IsInstantiated() && (vox->Transparent != _Opaque))
+            return vox;
 
         return nullptr;
     }
 
     Voxel CChunk::findVisible(const Math::Vec3i &_v, const CBBox &_ChunkDim) const
     {
-        Math::Vec3i relPos = (_v - _ChunkDim.Beg).abs();
-        CVoxel &vox = m_Data[relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z];
-        if(vox.IsInstantiated() && vox.IsVisible())
-            return &vox;
+        Math::Vec3i relPos = _v - _ChunkDim.Beg;
+        CVoxel *vox = At(relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z);
+        if(vox && vox->IsInstantiated() && vox->IsVisible())
+            return vox;
 
         return nullptr;
     }
 
     Voxel CChunk::findVisible(const Math::Vec3i &_v, const CBBox &_ChunkDim, bool _Opaque) const
     {
-        Math::Vec3i relPos = (_v - _ChunkDim.Beg).abs();
-        CVoxel &vox = m_Data[relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z];
-        if(vox.IsInstantiated() && vox.IsVisible() && (vox.Transparent != _Opaque))
-            return &vox;
+        Math::Vec3i relPos = _v - _ChunkDim.Beg;
+        CVoxel *vox = At(relPos.x + _ChunkDim.End.x * relPos.y + _ChunkDim.End.x * _ChunkDim.End.y * relPos.z);
+        if(vox && vox->IsInstantiated() && vox->IsVisible() && (vox->Transparent != _Opaque))
+            return vox;
 
         return nullptr;
     }
@@ -695,21 +1248,57 @@ namespace VCore
     {
         if(m_Data)
         {
-            delete[] m_Data;
+            m_Allocator->freeVoxels(m_Data);
             m_Data = nullptr;
         }
 
+        m_Sparse.clear();
+        m_VoxelCount = 0;
+
+        if(m_OpaqueRows)
+        {
+            m_Allocator->freeRows(m_OpaqueRows);
+            m_OpaqueRows = nullptr;
+            m_TransparentRows = nullptr;
+        }
+
+        if(m_PlaneCounts)
+        {
+            m_Allocator->freePlanes(m_PlaneCounts);
+            m_PlaneCounts = nullptr;
+        }
+
         m_InnerBBox = CBBox();
     }
 
+    void CChunk::detach()
+    {
+        m_Data = nullptr;
+        m_OpaqueRows = nullptr;
+        m_TransparentRows = nullptr;
+        m_PlaneCounts = nullptr;
+        m_VoxelCount = 0;
+    }
+
     CChunk &CChunk::operator=(CChunk &&_Other)
     {
         clear();
         m_InnerBBox = _Other.m_InnerBBox;
+        m_Allocator = _Other.m_Allocator;
         m_Data = _Other.m_Data;
+        m_Sparse = std::move(_Other.m_Sparse);
+        m_VoxelCount = _Other.m_VoxelCount;
+        m_PlaneCounts = _Other.m_PlaneCounts;
+        m_OpaqueRows = _Other.m_OpaqueRows;
+        m_TransparentRows = _Other.m_TransparentRows;
         IsDirty = _Other.IsDirty;
 
         _Other.m_Data = nullptr;
+        _Other.m_Sparse.clear();
+        _Other.m_VoxelCount = 0;
+        _Other.m_PlaneCounts = nullptr;
+        _Other.m_OpaqueRows = nullptr;
+        _Other.m_TransparentRows = nullptr;
         _Other.m_InnerBBox = CBBox();
         _Other.IsDirty = false;
 
@@ -720,8 +1309,10 @@ namespace VCore
     // CVoxelSpaceIterator functions
     //////////////////////////////////////////////////
 
-    CVoxelSpaceIterator::CVoxelSpaceIterator() : m_Space(nullptr), m_Pair(Math::Vec3i(), nullptr) { }
-    CVoxelSpaceIterator::CVoxelSpaceIterator(const CVoxelSpace *_Space, const CBBox &_InnerBox, const pair &_Pair) : m_Space(_Space), m_InnerBox(_InnerBox), m_Pair(_Pair) { }
+    constexpr size_t CVoxelSpaceIterator::NO_CURSOR;
+
+    CVoxelSpaceIterator::CVoxelSpaceIterator() : m_Space(nullptr), m_Chunk(0), m_Cursor(0), m_Pair(Math::Vec3i(), nullptr) { }
+    CVoxelSpaceIterator::CVoxelSpaceIterator(const CVoxelSpace *_Space, size_t _Chunk, size_t _Cursor, const pair &_Pair) : m_Space(_Space), m_Chunk(_Chunk), m_Cursor(_Cursor), m_Pair(_Pair) { }
     CVoxelSpaceIterator::CVoxelSpaceIterator(const CVoxelSpaceIterator &_Other)
     {
         *this = _Other;
@@ -744,14 +1335,20 @@ namespace VCore
     
     CVoxelSpaceIterator& CVoxelSpaceIterator::operator++()
     {
-        *this = m_Space->next(m_Pair.first);
+        // Iterators returned by find don't know their cursor yet.
+        if(m_Cursor == NO_CURSOR)
+        {
+            auto &chunk = m_Space->m_Chunks.values()[m_Chunk];
+            m_Cursor = chunk.second.cursorAfter(m_Pair.first, CBBox(chunk.first, m_Space->m_ChunkSize));
+        }
+
+        *this = m_Space->next(m_Chunk, m_Cursor);
         return *this;
     }
 
     CVoxelSpaceIterator& CVoxelSpaceIterator::operator++(int)
     {
-        *this = m_Space->next(m_Pair.first);
-        return *this;
+        return ++(*this);
     }
 
     bool CVoxelSpaceIterator::operator!=(const CVoxelSpaceIterator &_Rhs)
@@ -767,8 +1364,9 @@ namespace VCore
     CVoxelSpaceIterator& CVoxelSpaceIterator::operator=(const CVoxelSpaceIterator &_Other)
     {
         m_Space = _Other.m_Space;
+        m_Chunk = _Other.m_Chunk;
+        m_Cursor = _Other.m_Cursor;
         m_Pair = _Other.m_Pair;
-        m_InnerBox = _Other.m_InnerBox;
 
         return *this;
     }
@@ -776,12 +1374,12 @@ namespace VCore
     CVoxelSpaceIterator& CVoxelSpaceIterator::operator=(CVoxelSpaceIterator &&_Other)
     {
         m_Space = _Other.m_Space;
+        m_Chunk = _Other.m_Chunk;
+        m_Cursor = _Other.m_Cursor;
         m_Pair = _Other.m_Pair;
-        m_InnerBox = _Other.m_InnerBox;
 
         _Other.m_Space = nullptr;
         _Other.m_Pair = {Math::Vec3i(), nullptr};
-        _Other.m_InnerBox = CBBox();
 
         return *this;
     }
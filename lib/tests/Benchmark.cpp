@@ -0,0 +1,197 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Benchmark of the voxel storage and the meshers on a noisy sphere. Also counts the allocations of the meshers.
+ * 
+ * Usage: VCoreBenchmark [radius], the default radius is 64. Run it on two revisions to compare them.
+ */
+
+#include "TestHelpers.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <vector>
+
+using namespace VCore;
+
+// Counts every allocation of the process, also the ones inside of the library.
+static std::atomic<size_t> g_Allocations(0);
+static std::atomic<size_t> g_AllocatedBytes(0);
+
+void *operator new(size_t _Size)
+{
+    g_Allocations++;
+    g_AllocatedBytes += _Size;
+
+    void *ret = malloc(_Size ? _Size : 1);
+    if(!ret)
+        throw std::bad_alloc();
+
+    return ret;
+}
+
+void operator delete(void *_Ptr) noexcept
+{
+    free(_Ptr);
+}
+
+void operator delete(void *_Ptr, size_t) noexcept
+{
+    free(_Ptr);
+}
+
+namespace
+{
+    /**
+     * @return Runs _Fn _Runs times and returns the milliseconds of the fastest run.
+     */
+    double Measure(int _Runs, const std::function<void()> &_Fn)
+    {
+        double best = 0;
+        for (int i = 0; i < _Runs; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            _Fn();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if(i == 0 || ms < best)
+                best = ms;
+        }
+
+        return best;
+    }
+
+    void BenchmarkVoxelSpace(int _Radius)
+    {
+        std::vector<std::pair<Math::Vec3i, CVoxel>> voxels;
+        for (int x = -_Radius; x < _Radius; x++)
+        {
+            for (int y = -_Radius; y < _Radius; y++)
+            {
+                for (int z = -_Radius; z < _Radius; z++)
+                {
+                    if(x * x + y * y + z * z >= _Radius * _Radius)
+                        continue;
+
+                    CVoxel voxel;
+                    voxel.Color = 0;
+                    voxel.Material = 0;
+                    voxels.push_back({Math::Vec3i(x, y, z), voxel});
+                }
+            }
+        }
+
+        printf("Voxel space, %zu voxels\n", voxels.size());
+
+        double ms = Measure(3, [&]() {
+            CVoxelModel model;
+            for (auto &&v : voxels)
+                model.SetVoxel(v.first, 0, 0, false);
+        });
+        printf("  %-16s %10.1f ms\n", "SetVoxel", ms);
+
+        ms = Measure(3, [&]() {
+            CVoxelModel model;
+            model.BeginBulkInsert();
+            for (auto &&v : voxels)
+                model.SetVoxel(v.first, 0, 0, false);
+            model.EndBulkInsert();
+        });
+        printf("  %-16s %10.1f ms\n", "bulk insert", ms);
+
+        CVoxelSpace space;
+        space.insert(voxels);
+        ms = Measure(3, [&]() {
+            size_t found = 0;
+            for (auto &&v : voxels)
+                found += space.find(v.first) != space.end();
+
+            if(found != voxels.size())
+                printf("  find lost voxels!\n");
+        });
+        printf("  %-16s %10.1f ms\n", "find all", ms);
+    }
+
+    void BenchmarkMeshers(int _Radius)
+    {
+        auto model = Test::CreateSphere(_Radius, 1);
+        printf("Meshers, noisy sphere of radius %d\n", _Radius);
+
+        const std::pair<const char*, MesherTypes> meshers[] = {
+            {"simple", MesherTypes::SIMPLE},
+            {"greedy", MesherTypes::GREEDY},
+            {"greedy chunked", MesherTypes::GREEDY_CHUNKED},
+            {"greedy mask", MesherTypes::GREEDY_MASK},
+            {"marching cubes", MesherTypes::MARCHING_CUBES},
+            {"surface nets", MesherTypes::SURFACE_NETS},
+        };
+
+        for (auto &&m : meshers)
+        {
+            auto mesher = IMesher::Create(m.second);
+            size_t triangles = 0;
+            double ms = Measure(3, [&]() {
+                triangles = Test::Signature(mesher->GenerateChunks(model)).Triangles;
+            });
+
+            printf("  %-16s %10.1f ms %10zu triangles\n", m.first, ms, triangles);
+        }
+    }
+
+    void BenchmarkAllocations(int _Radius)
+    {
+        auto model = Test::CreateSphere(_Radius, 1);
+        printf("Allocations of GenerateMesh, noisy sphere of radius %d\n", _Radius);
+
+        const std::pair<const char*, MesherTypes> meshers[] = {
+            {"simple", MesherTypes::SIMPLE},
+            {"greedy", MesherTypes::GREEDY},
+            {"greedy mask", MesherTypes::GREEDY_MASK},
+        };
+
+        for (auto &&m : meshers)
+        {
+            auto mesher = IMesher::Create(m.second);
+            mesher->GenerateMesh(model);    // Starts the thread pool of the mesher.
+
+            size_t allocations = g_Allocations;
+            size_t bytes = g_AllocatedBytes;
+            mesher->GenerateMesh(model);
+
+            printf("  %-16s %10zu allocations %8.1f MB\n", m.first, g_Allocations - allocations, (g_AllocatedBytes - bytes) / (1024.0 * 1024.0));
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int radius = argc > 1 ? atoi(argv[1]) : 64;
+    BenchmarkVoxelSpace(radius);
+    BenchmarkMeshers(radius);
+    BenchmarkAllocations(radius);
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TestHelpers.hpp"
+#include <map>
+
+using namespace VCore;
+
+namespace
+{
+    struct SCase
+    {
+        const char *Name;
+        MesherTypes Type;
+        bool AmbientOcclusion;
+        bool Smooth;
+    };
+
+    Mesher CreateMesher(const SCase &_Case)
+    {
+        auto mesher = IMesher::Create(_Case.Type);
+        mesher->SetAmbientOcclusion(_Case.AmbientOcclusion);
+        mesher->SetSmoothShading(_Case.Smooth, _Case.Smooth ? 2 : 0);
+        return mesher;
+    }
+
+    /**
+     * @brief Compares the chunks a client assembled from the deltas of ::UpdateChunks with a full ::GenerateChunks.
+     */
+    bool Compare(const SCase &_Case, VoxelModel _Model, const std::map<size_t, Test::SMeshSignature> &_Client, int _Round)
+    {
+        std::map<size_t, Test::SMeshSignature> expected;
+        for (auto &&c : CreateMesher(_Case)->GenerateChunks(_Model))
+        {
+            if(!expected.insert({c.UniqueId, Test::Signature(c.MeshData)}).second)
+            {
+                printf("FAILED: %s, round %d: duplicated chunk id\n", _Case.Name, _Round);
+                return false;
+            }
+        }
+
+        size_t mismatches = 0;
+        for (auto &&c : expected)
+        {
+            auto it = _Client.find(c.first);
+            if(it == _Client.end() || !it->second.Equals(c.second))
+                mismatches++;
+        }
+
+        if(mismatches != 0 || expected.size() != _Client.size())
+        {
+            printf("FAILED: %s, round %d: %zu of %zu chunks differ, %zu chunks cached\n", _Case.Name, _Round, mismatches, expected.size(), _Client.size());
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Run(const SCase &_Case)
+    {
+        const int radius = 19;
+        auto model = Test::CreateSphere(radius, 7);
+        auto mesher = CreateMesher(_Case);
+        std::mt19937 rng(13);
+
+        std::map<size_t, Test::SMeshSignature> client;
+        for (int round = 0; round < 4; round++)
+        {
+            if(round > 0)
+            {
+                for (int i = 0; i < 40; i++)
+                {
+                    Math::Vec3i pos;
+                    for (int j = 0; j < 3; j++)
+                        pos.v[j] = (int)(rng() % (radius * 2 + 4)) - radius - 2;
+
+                    if(rng() % 2)
+                        model->RemoveVoxel(pos);
+                    else
+                        model->SetVoxel(pos, rng() % 2, rng() % 8, false);
+                }
+
+                // Empties a whole chunk, so the delta must remove it.
+                if(round == 2)
+                {
+                    for (int x = 0; x < 16; x++)
+                        for (int y = 0; y < 16; y++)
+                            for (int z = 0; z < 16; z++)
+                                model->RemoveVoxel(Math::Vec3i(x, y, z));
+                }
+            }
+
+            auto delta = mesher->UpdateChunks(model);
+            for (auto &&c : delta.Added)
+                client[c.UniqueId] = Test::Signature(c.MeshData);
+
+            for (auto &&c : delta.Updated)
+                client[c.UniqueId] = Test::Signature(c.MeshData);
+
+            for (auto &&id : delta.Removed)
+                client.erase(id);
+
+            if(!Compare(_Case, model, client, round))
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Chunks of different levels of detail may start at the same position, but must still have distinct ids.
+     */
+    bool RunLod()
+    {
+        auto model = Test::CreateSphere(40, 3);
+        auto mesher = IMesher::Create(MesherTypes::SIMPLE);
+        mesher->SetLod(Math::Vec3f(-40, -40, -40), {30, 60});
+
+        std::map<size_t, int> ids;
+        for (auto &&c : mesher->GenerateChunks(model))
+        {
+            if(!ids.insert({c.UniqueId, c.Lod}).second)
+            {
+                printf("FAILED: lod: duplicated chunk id\n");
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+int main()
+{
+    const SCase cases[] = {
+        {"simple", MesherTypes::SIMPLE, false, false},
+        {"simple ao", MesherTypes::SIMPLE, true, false},
+        {"greedy chunked", MesherTypes::GREEDY_CHUNKED, false, false},
+        {"greedy mask", MesherTypes::GREEDY_MASK, false, false},
+        {"greedy mask ao", MesherTypes::GREEDY_MASK, true, false},
+        {"marching cubes", MesherTypes::MARCHING_CUBES, false, false},
+        {"marching cubes smooth", MesherTypes::MARCHING_CUBES, false, true},
+        {"surface nets", MesherTypes::SURFACE_NETS, false, false},
+    };
+
+    int failed = 0;
+    for (auto &&c : cases)
+    {
+        if(!Run(c))
+            failed++;
+    }
+
+    if(!RunLod())
+        failed++;
+
+    return failed == 0 ? 0 : 1;
+}
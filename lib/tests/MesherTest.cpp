@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TestHelpers.hpp"
+#include <map>
+
+using namespace VCore;
+
+namespace
+{
+    const MesherTypes ALL_MESHERS[] = {
+        MesherTypes::SIMPLE,
+        MesherTypes::GREEDY,
+        MesherTypes::MARCHING_CUBES,
+        MesherTypes::GREEDY_CHUNKED,
+        MesherTypes::GREEDY_MASK,
+        MesherTypes::SURFACE_NETS,
+    };
+
+    /**
+     * @brief Models without a color palette must be meshed without touching the textures of the model.
+     */
+    bool TestWithoutPalette()
+    {
+        bool ret = true;
+        for (auto type : ALL_MESHERS)
+        {
+            auto model = Test::CreateSphere(12, 5);
+            model->Textures.clear();
+
+            auto mesh = IMesher::Create(type)->GenerateMesh(model);
+            ret &= Test::Check(mesh && !mesh->Surfaces.empty(), "A model without palette must be meshed");
+            ret &= Test::Check(model->Textures.empty(), "Meshing must not add textures to the model");
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief The mask greedy mesher merges the same faces inside of each chunk as the chunked greedy mesher.
+     */
+    bool TestMaskGreedyMatchesChunkedGreedy()
+    {
+        auto model = Test::CreateSphere(30, 9);
+        auto chunked = IMesher::Create(MesherTypes::GREEDY_CHUNKED)->GenerateChunks(model);
+        auto mask = IMesher::Create(MesherTypes::GREEDY_MASK)->GenerateChunks(model);
+
+        std::map<size_t, Test::SMeshSignature> expected;
+        for (auto &&c : chunked)
+            expected[c.UniqueId] = Test::Signature(c.MeshData);
+
+        bool ret = Test::Check(chunked.size() == mask.size(), "Both greedy meshers must return the same chunks");
+        for (auto &&c : mask)
+        {
+            auto it = expected.find(c.UniqueId);
+            ret &= Test::Check(it != expected.end() && it->second.Equals(Test::Signature(c.MeshData)), "The mask greedy mesher must match the chunked greedy mesher");
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief All block meshers must cover the same visible faces, the greedy ones only with fewer triangles.
+     */
+    bool TestBlockMeshersCoverSameFaces()
+    {
+        bool ret = true;
+        for (bool ao : {false, true})
+        {
+            auto model = Test::CreateSphere(30, 4);
+            auto create = [ao](MesherTypes _Type) {
+                auto mesher = IMesher::Create(_Type);
+                mesher->SetAmbientOcclusion(ao);
+                return mesher;
+            };
+
+            auto simple = Test::Signature(create(MesherTypes::SIMPLE)->GenerateChunks(model));
+            auto greedy = Test::Signature(create(MesherTypes::GREEDY)->GenerateChunks(model));
+            auto mask = Test::Signature(create(MesherTypes::GREEDY_MASK)->GenerateChunks(model));
+
+            ret &= Test::Check(std::fabs(simple.Area - greedy.Area) < 1e-3 && std::fabs(simple.Moment - greedy.Moment) < 1, "The greedy mesher must cover the faces of the simple mesher");
+            ret &= Test::Check(std::fabs(simple.Area - mask.Area) < 1e-3 && std::fabs(simple.Moment - mask.Moment) < 1, "The mask greedy mesher must cover the faces of the simple mesher");
+            ret &= Test::Check(greedy.Triangles <= mask.Triangles && mask.Triangles < simple.Triangles, "Greedy meshing must merge faces");
+        }
+
+        return ret;
+    }
+}
+
+int main()
+{
+    int failed = 0;
+    if(!TestWithoutPalette())
+        failed++;
+
+    if(!TestMaskGreedyMatchesChunkedGreedy())
+        failed++;
+
+    if(!TestBlockMeshersCoverSameFaces())
+        failed++;
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TESTHELPERS_HPP
+#define TESTHELPERS_HPP
+
+#include <VCore/Meshing/IMesher.hpp>
+#include <VCore/Voxel/VoxelModel.hpp>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace VCore
+{
+    namespace Test
+    {
+        /**
+         * @brief Order independent fingerprint of a mesh.
+         */
+        struct SMeshSignature
+        {
+            size_t Triangles = 0;
+            double Area = 0;        //!< Sum of all triangle areas.
+            double Moment = 0;      //!< Sum of the area weighted triangle centers, detects moved faces.
+
+            bool Equals(const SMeshSignature &_Other) const
+            {
+                return Triangles == _Other.Triangles && std::fabs(Area - _Other.Area) < 1e-3 && std::fabs(Moment - _Other.Moment) < 1e-2;
+            }
+        };
+
+        inline SMeshSignature Signature(const Mesh &_Mesh)
+        {
+            SMeshSignature ret;
+            if(!_Mesh)
+                return ret;
+
+            for (auto &&surface : _Mesh->Surfaces)
+            {
+                for (size_t i = 0; i + 2 < surface.Indices.size(); i += 3)
+                {
+                    Math::Vec3f a = surface[surface.Indices[i]].Pos;
+                    Math::Vec3f b = surface[surface.Indices[i + 1]].Pos;
+                    Math::Vec3f c = surface[surface.Indices[i + 2]].Pos;
+
+                    double area = (b - a).cross(c - a).length() * 0.5;
+                    Math::Vec3f center = (a + b + c) / 3.f;
+
+                    ret.Triangles++;
+                    ret.Area += area;
+                    ret.Moment += area * (center.x * 1.3 + center.y * 2.7 + center.z * 5.1);
+                }
+            }
+
+            return ret;
+        }
+
+        inline SMeshSignature Signature(const std::vector<SMeshChunk> &_Chunks)
+        {
+            SMeshSignature ret;
+            for (auto &&c : _Chunks)
+            {
+                auto s = Signature(c.MeshData);
+                ret.Triangles += s.Triangles;
+                ret.Area += s.Area;
+                ret.Moment += s.Moment;
+            }
+
+            return ret;
+        }
+
+        /**
+         * @brief Creates a noisy sphere around the origin with two materials and a small palette.
+         */
+        inline VoxelModel CreateSphere(int _Radius, unsigned _Seed)
+        {
+            auto model = std::make_shared<CVoxelModel>();
+            model->Materials.push_back(std::make_shared<CMaterial>());
+            model->Materials.push_back(std::make_shared<CMaterial>());
+
+            auto palette = std::make_shared<CTexture>(Math::Vec2ui(8, 1));
+            for (int i = 0; i < 8; i++)
+                palette->AddPixel(CColor(i * 30, 255 - i * 30, i * 10, 255), Math::Vec2ui(i, 0));
+
+            model->Textures[TextureType::DIFFIUSE] = palette;
+
+            std::mt19937 rng(_Seed);
+            model->BeginBulkInsert();
+            for (int x = -_Radius; x < _Radius; x++)
+            {
+                for (int y = -_Radius; y < _Radius; y++)
+                {
+                    for (int z = -_Radius; z < _Radius; z++)
+                    {
+                        if(x * x + y * y + z * z < _Radius * _Radius && (rng() % 50) != 0)
+                            model->SetVoxel(Math::Vec3i(x, y, z), (x > 0) ? 1 : 0, (rng() % 8), x < -_Radius / 2 && y > 0);
+                    }
+                }
+            }
+            model->EndBulkInsert();
+
+            return model;
+        }
+
+        inline bool Check(bool _Condition, const char *_Message)
+        {
+            if(!_Condition)
+                printf("FAILED: %s\n", _Message);
+
+            return _Condition;
+        }
+    }
+}
+
+#endif //TESTHELPERS_HPP
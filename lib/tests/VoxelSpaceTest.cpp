@@ -0,0 +1,112 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TestHelpers.hpp"
+#include <map>
+#include <tuple>
+
+using namespace VCore;
+
+namespace
+{
+    using Reference = std::map<std::tuple<int, int, int>, int>;
+
+    bool Compare(const CVoxelSpace &_Space, const Reference &_Reference, std::mt19937 &_Rng, const char *_Name)
+    {
+        bool ret = Test::Check(_Space.size() == _Reference.size(), _Name);
+
+        for (auto &&r : _Reference)
+        {
+            auto it = _Space.find(Math::Vec3i(std::get<0>(r.first), std::get<1>(r.first), std::get<2>(r.first)));
+            if(it == _Space.end() || it->second->Color != r.second)
+                return Test::Check(false, _Name);
+        }
+
+        // Positions without a voxel must not be found, also in chunks which exist.
+        for (int i = 0; i < 1000; i++)
+        {
+            Math::Vec3i pos;
+            for (int j = 0; j < 3; j++)
+                pos.v[j] = (int)(_Rng() % 160) - 80;
+
+            bool expected = _Reference.find(std::make_tuple(pos.x, pos.y, pos.z)) != _Reference.end();
+            if((_Space.find(pos) != _Space.end()) != expected)
+                return Test::Check(false, _Name);
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief Inserts, finds and erases random voxels around the origin and compares the space with a plain map.
+     */
+    bool Run(const Math::Vec3i &_ChunkSize, const char *_Name)
+    {
+        CVoxelSpace space(_ChunkSize);
+        Reference reference;
+        std::mt19937 rng(11);
+
+        for (int i = 0; i < 20000; i++)
+        {
+            Math::Vec3i pos;
+            for (int j = 0; j < 3; j++)
+                pos.v[j] = (int)(rng() % 140) - 70;
+
+            CVoxel voxel;
+            voxel.Color = rng() % 100;
+            voxel.Material = 0;
+            space.insert({pos, voxel});
+            reference[std::make_tuple(pos.x, pos.y, pos.z)] = voxel.Color;
+        }
+
+        bool ret = Compare(space, reference, rng, _Name);
+
+        for (auto it = reference.begin(); it != reference.end();)
+        {
+            if(rng() % 2)
+            {
+                space.erase(space.find(Math::Vec3i(std::get<0>(it->first), std::get<1>(it->first), std::get<2>(it->first))));
+                it = reference.erase(it);
+            }
+            else
+                ++it;
+        }
+
+        ret &= Compare(space, reference, rng, _Name);
+        return ret;
+    }
+}
+
+int main()
+{
+    int failed = 0;
+    if(!Run(Math::Vec3i(16, 16, 16), "chunk size 16"))
+        failed++;
+
+    // Chunk sizes are rounded up to the next power of two.
+    if(!Run(Math::Vec3i(10, 20, 33), "chunk size 10x20x33"))
+        failed++;
+
+    return failed == 0 ? 0 : 1;
+}